@@ -5,6 +5,7 @@
 #include <codecvt>
 #include <cmath>
 #include <execution>
+#include <vector>
 
 #include "public.sdk/source/vst/vsteditcontroller.h"
 
@@ -17,7 +18,8 @@ struct CustomParameter
 		double min_ = 0, double max_ = 1, double defaultPlain_ = 1, int stepCount_ = 0, double skewFactor_ = 0.0,
 		std::function<const double(const double normalised)> plainToRealFunc_ = { [](double plain) { return plain; } },
 
-		int32_t flags_ = Steinberg::Vst::ParameterInfo::ParameterFlags::kCanAutomate) :
+		int32_t flags_ = Steinberg::Vst::ParameterInfo::ParameterFlags::kCanAutomate,
+		std::initializer_list<const char*> valueNames_ = {}) :
 
 		id(id_),
 		title(title_),
@@ -30,9 +32,11 @@ struct CustomParameter
 		stepCount(stepCount_),
 		skewFactor(skewFactor_),
 		plainToReal(plainToRealFunc_),
-		flags(flags_)
+		flags(flags_),
+		valueNames(valueNames_.begin(), valueNames_.end())
 	{
 		assert(stepCount == 0 || stepCount == int(maxPlain - minPlain));
+		assert(valueNames.empty() || int(valueNames.size()) == stepCount + 1);
 
 		if (skewFactor != 0.0)
 		{
@@ -74,6 +78,9 @@ struct CustomParameter
 	const int stepCount;
 	const int32_t flags;
 
+	// Display names of the steps of a list parameter, from minPlain up.
+	const std::vector<std::string> valueNames;
+
 	// Convert the plain paramValue to a working paramValue (eg. db to linear gain).
 	std::function<const double(const double plain)> plainToReal;
 
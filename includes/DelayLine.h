@@ -0,0 +1,50 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+// Fixed delay of a signal, kept in double whatever its precision.
+class DelayLine {
+public:
+	// Allocates.
+	void prepare(int delaySamples)
+	{
+		assert(delaySamples > 0);
+
+		buffer.assign(delaySamples, 0.0);
+		position = 0;
+	}
+
+	void reset()
+	{
+		std::fill(buffer.begin(), buffer.end(), 0.0);
+		position = 0;
+	}
+
+	// out may be in.
+	template <typename T>
+	void process(const T* in, T* out, int samples)
+	{
+		const int size = int(buffer.size());
+
+		for (int done = 0; done < samples;)
+		{
+			const int count = (std::min)(samples - done, size - position);
+			double* delayed = buffer.data() + position;
+
+			for (int s = 0; s < count; ++s)
+			{
+				const double x = static_cast<double>(in[done + s]);
+				out[done + s] = static_cast<T>(delayed[s]);
+				delayed[s] = x;
+			}
+
+			done += count;
+			position = (position + count) % size;
+		}
+	}
+
+private:
+	std::vector<double> buffer;
+	int position = 0;
+};
@@ -2,6 +2,8 @@
 #include <algorithm>
 #include <constants.h>
 
+#include "Halfband.h"
+
 // https://www.desmos.com/calculator/fagrsqzigt
 
 class Distortion {
@@ -16,9 +18,21 @@ public:
 		sampleRate = samplerate;
 
 		setDriveTime(driveTime);
+	}
+
+	// The block buffers are written before they're read, only the recursions are cleared.
+	void reset()
+	{
+		env0 = env0Z1 = 0.0;
 
-		std::fill(factor, factor + MAX_BUFFER_SIZE, 0.0);
-		std::fill(dry, dry + MAX_BUFFER_SIZE, 0.0);
+		upsampler.reset();
+		downsampler.reset();
+	}
+
+	// Not finite if any of the recursions isn't.
+	double stateSum() const
+	{
+		return env0Z1 + upsampler.stateSum() + downsampler.stateSum();
 	}
 
 	void setDriveTime(double ms) 
@@ -42,6 +56,41 @@ public:
 			input[s] = dry[s] * input[s] + (1.0 - dry[s]) * input[s] * (27.0 + factor[s] * input[s]) / (27.0 + 9.0 * factor[s] * input[s]);
 	}
 
+	// Same curve computed at twice the sample rate, blended in by oversampling (0 to 1) per sample.
+	// The whole signal goes through the halfband filters, so the distortion stays aligned with the
+	// signal it came from. The dry signal in the mix goes through a Halfband::RoundTrip to match.
+	inline void process(double* input, int numSamples, const double* oversampling)
+	{
+		for (int s = 0; s < numSamples; ++s)
+		{
+			env0 = slide(abs(input[s]), env0Z1, driveTimeSamps);
+			env0Z1 = env0;
+
+			drive[s] = min(env0, 1.4);
+			dry[s] = min(1.0, 3.2 * env0);
+		}
+
+		upsampler.process(input, upsampled, numSamples);
+
+		for (int i = 0; i < 2 * numSamples; ++i)
+		{
+			const double x = upsampled[i];
+			const double f = x + drive[i / 2];
+
+			upsampled[i] = dry[i / 2] * x + (1.0 - dry[i / 2]) * x * (27.0 + f * x) / (27.0 + 9.0 * f * x);
+		}
+
+		downsampler.process(upsampled, oversampled, numSamples);
+
+		for (int s = 0; s < numSamples; ++s)
+		{
+			const double f = input[s] + drive[s];
+			const double plain = dry[s] * input[s] + (1.0 - dry[s]) * input[s] * (27.0 + f * input[s]) / (27.0 + 9.0 * f * input[s]);
+
+			input[s] = plain + oversampling[s] * (oversampled[s] - plain);
+		}
+	}
+
 private:
 	double sampleRate = 44100;
 	double driveTime = 113,
@@ -50,6 +99,14 @@ private:
 	double env0 = 0,
 		env0Z1 = 0;
 
-	double factor[MAX_BUFFER_SIZE],
-		dry[MAX_BUFFER_SIZE];
+	alignas(BUFFER_ALIGNMENT) double factor[MAX_BUFFER_SIZE];
+	alignas(BUFFER_ALIGNMENT) double dry[MAX_BUFFER_SIZE];
+
+	// Oversampled path.
+	Halfband::Upsampler upsampler;
+	Halfband::Downsampler downsampler;
+
+	alignas(BUFFER_ALIGNMENT) double drive[MAX_BUFFER_SIZE];
+	alignas(BUFFER_ALIGNMENT) double upsampled[2 * MAX_BUFFER_SIZE];
+	alignas(BUFFER_ALIGNMENT) double oversampled[MAX_BUFFER_SIZE];
 };
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+
+// Output stage kernels: out = wet * mix * gain + in * (1 - mix).
+// The host's input buffer is never written, the sample type conversion happens in the same pass.
+
+// Separate input and output buffers.
+template <typename SampleType>
+inline static void mixOutOfPlace(SampleType* __restrict out, const SampleType* __restrict in, const double* __restrict wet,
+	const double* __restrict mix, const double* __restrict gain, const int samples)
+{
+	for (int s = 0; s < samples; ++s)
+		out[s] = static_cast<SampleType>(wet[s] * mix[s] * gain[s] + static_cast<double>(in[s]) * (1.0 - mix[s]));
+}
+
+// Host passed the same buffer as input and output.
+template <typename SampleType>
+inline static void mixInPlace(SampleType* io, const double* __restrict wet, const double* __restrict mix,
+	const double* __restrict gain, const int samples)
+{
+	for (int s = 0; s < samples; ++s)
+	{
+		const double dry = static_cast<double>(io[s]);
+		io[s] = static_cast<SampleType>(wet[s] * mix[s] * gain[s] + dry * (1.0 - mix[s]));
+	}
+}
+
+// Mix at 100%, the dry signal isn't read at all.
+template <typename SampleType>
+inline static void mixWetOnly(SampleType* __restrict out, const double* __restrict wet, const double* __restrict gain, const int samples)
+{
+	for (int s = 0; s < samples; ++s)
+		out[s] = static_cast<SampleType>(wet[s] * gain[s]);
+}
+
+// Constant mix and gain, with the dry blend and the gain compiled out when a block doesn't need them.
+// Input and output may alias, each sample is read before it's written.
+template <bool Dry, bool Gain, typename SampleType>
+inline static void mixConstant(SampleType* out, const SampleType* in, const double* __restrict wet, const double mix,
+	const double gain, const int samples)
+{
+	const double dryGain = 1.0 - mix;
+
+	for (int s = 0; s < samples; ++s)
+	{
+		if constexpr (Dry)
+		{
+			const double dry = static_cast<double>(in[s]);
+			double processed = wet[s] * mix;
+
+			if constexpr (Gain)
+				processed *= gain;
+
+			out[s] = static_cast<SampleType>(processed + dry * dryGain);
+		}
+		else if constexpr (Gain)
+		{
+			out[s] = static_cast<SampleType>(wet[s] * gain);
+		}
+		else
+		{
+			out[s] = static_cast<SampleType>(wet[s]);
+		}
+	}
+}
+
+// Linear crossfade towards the untouched input (bypassed) while bypass is ramping. Wet and dry are
+// close to each other, an equal power fade would lift them by 3 dB halfway. In is the dry signal of
+// the mix, lined up with the wet one. Either may alias the output.
+template <typename SampleType>
+inline static void mixCrossfade(SampleType* out, const SampleType* in, const SampleType* bypassed, const double* __restrict wet,
+	const double* __restrict mix, const double* __restrict gain, const double* __restrict bypass, const int samples)
+{
+	for (int s = 0; s < samples; ++s)
+	{
+		const double dry = static_cast<double>(in[s]);
+		const double processed = wet[s] * mix[s] * gain[s] + dry * (1.0 - mix[s]);
+
+		out[s] = static_cast<SampleType>(processed + (static_cast<double>(bypassed[s]) - processed) * bypass[s]);
+	}
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <constants.h>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define KWIRE2_DUAL_ENVELOPE_SSE2
+#endif
+
+// Mid and side envelope followers, run as the two lanes of one recursion.
+//
+// Each lane slides towards its own attenuation, y = z1 + (x - z1) * coefficient, with the release
+// coefficient while the attenuation rises and the attack one while it falls. The coefficients are
+// the reciprocals of the slide times, set per sample before processing. With SSE2 both lanes share
+// a register, so following the side costs no more than following the mid alone.
+class DualEnvelope {
+public:
+	enum Lane {
+		Mid,
+		Side
+	};
+
+	// Slide times in samples, at least one.
+	inline void setTimes(int s, Lane lane, double attackSamples, double releaseSamples)
+	{
+		attackCoefficient[s][lane] = 1.0 / max(1.0, attackSamples);
+		releaseCoefficient[s][lane] = 1.0 / max(1.0, releaseSamples);
+	}
+
+	// mid and side hold the attenuations and are overwritten with the envelopes.
+	void process(double* mid, double* side, int samples)
+	{
+#ifdef KWIRE2_DUAL_ENVELOPE_SSE2
+		__m128d z = _mm_load_pd(state);
+
+		for (int s = 0; s < samples; ++s)
+		{
+			const __m128d x = _mm_set_pd(side[s], mid[s]);
+			const __m128d rising = _mm_cmpge_pd(x, z);
+			const __m128d coefficient = _mm_or_pd(_mm_and_pd(rising, _mm_load_pd(releaseCoefficient[s])),
+				_mm_andnot_pd(rising, _mm_load_pd(attackCoefficient[s])));
+
+			z = _mm_add_pd(z, _mm_mul_pd(_mm_sub_pd(x, z), coefficient));
+
+			_mm_storel_pd(mid + s, z);
+			_mm_storeh_pd(side + s, z);
+		}
+
+		_mm_store_pd(state, z);
+#else
+		for (int s = 0; s < samples; ++s)
+		{
+			mid[s] = step(Mid, s, mid[s]);
+			side[s] = step(Side, s, side[s]);
+		}
+#endif
+	}
+
+	inline double value(Lane lane) const
+	{
+		return state[lane];
+	}
+
+	// Both lanes back to no attenuation.
+	void reset()
+	{
+		state[Mid] = state[Side] = 1.0;
+	}
+
+	inline double stateSum() const
+	{
+		return state[Mid] + state[Side];
+	}
+
+	// Mid lane only, for analysis. The side lane keeps its state.
+	void processMid(double* mid, int samples)
+	{
+		for (int s = 0; s < samples; ++s)
+			mid[s] = step(Mid, s, mid[s]);
+	}
+
+private:
+	inline double step(Lane lane, int s, double x)
+	{
+		const double coefficient = x >= state[lane] ? releaseCoefficient[s][lane] : attackCoefficient[s][lane];
+
+		state[lane] += (x - state[lane]) * coefficient;
+		return state[lane];
+	}
+
+	alignas(16) double attackCoefficient[MAX_BUFFER_SIZE][2];
+	alignas(16) double releaseCoefficient[MAX_BUFFER_SIZE][2];
+	alignas(16) double state[2] = { 1.0, 1.0 };
+};
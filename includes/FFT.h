@@ -0,0 +1,122 @@
+#pragma once
+#define _USE_MATH_DEFINES
+#include <bit>
+#include <cassert>
+#include <math.h>
+#include <utility>
+#include <vector>
+
+// Radix-2 complex FFT on split real and imaginary arrays, in place.
+//
+// The bit reversal and the twiddles are tabled by prepare, which allocates; the transforms don't.
+// Each stage reads its twiddles contiguously, so the butterflies vectorise. Real signals go in two
+// at a time, one in each part: the spectrum of a real filter applied to both is still one product.
+class FFT {
+public:
+	// size is a power of two.
+	void prepare(int size)
+	{
+		assert(std::has_single_bit(unsigned(size)));
+
+		n = size;
+		reversed.assign(n, 0);
+		twiddleRe.assign(n, 0.0);
+		twiddleIm.assign(n, 0.0);
+
+		const int bits = std::countr_zero(unsigned(n));
+
+		for (int i = 0; i < n; ++i)
+		{
+			for (int b = 0; b < bits; ++b)
+				reversed[i] |= ((i >> b) & 1) << (bits - 1 - b);
+		}
+
+		// The stage joining halves of length half reads exp(-i pi k / half) from twiddle[half + k].
+		for (int half = 1; half < n; half *= 2)
+		{
+			for (int k = 0; k < half; ++k)
+			{
+				twiddleRe[half + k] = cos(M_PI * k / half);
+				twiddleIm[half + k] = -sin(M_PI * k / half);
+			}
+		}
+	}
+
+	int size() const
+	{
+		return n;
+	}
+
+	// X[k] = sum x[t] exp(-2 pi i k t / n)
+	void forward(double* re, double* im) const
+	{
+		for (int i = 0; i < n; ++i)
+		{
+			const int j = reversed[i];
+
+			if (i < j)
+			{
+				std::swap(re[i], re[j]);
+				std::swap(im[i], im[j]);
+			}
+		}
+
+		// The first two stages together, their twiddles are 1 and -i.
+		for (int start = 0; start + 4 <= n; start += 4)
+		{
+			double* r = re + start;
+			double* i = im + start;
+
+			const double sumRe = r[0] + r[1], differenceRe = r[0] - r[1];
+			const double sumIm = i[0] + i[1], differenceIm = i[0] - i[1];
+			const double nextSumRe = r[2] + r[3], nextDifferenceRe = r[2] - r[3];
+			const double nextSumIm = i[2] + i[3], nextDifferenceIm = i[2] - i[3];
+
+			r[0] = sumRe + nextSumRe;
+			i[0] = sumIm + nextSumIm;
+			r[2] = sumRe - nextSumRe;
+			i[2] = sumIm - nextSumIm;
+			r[1] = differenceRe + nextDifferenceIm;
+			i[1] = differenceIm - nextDifferenceRe;
+			r[3] = differenceRe - nextDifferenceIm;
+			i[3] = differenceIm + nextDifferenceRe;
+		}
+
+		for (int half = n < 4 ? 1 : 4; half < n; half *= 2)
+		{
+			const double* wRe = twiddleRe.data() + half;
+			const double* wIm = twiddleIm.data() + half;
+
+			for (int start = 0; start < n; start += 2 * half)
+			{
+				double* aRe = re + start;
+				double* aIm = im + start;
+				double* bRe = aRe + half;
+				double* bIm = aIm + half;
+
+				for (int k = 0; k < half; ++k)
+				{
+					const double tRe = bRe[k] * wRe[k] - bIm[k] * wIm[k];
+					const double tIm = bRe[k] * wIm[k] + bIm[k] * wRe[k];
+
+					bRe[k] = aRe[k] - tRe;
+					bIm[k] = aIm[k] - tIm;
+					aRe[k] += tRe;
+					aIm[k] += tIm;
+				}
+			}
+		}
+	}
+
+	// Inverse without the 1 / n: the forward transform with the parts swapped.
+	void inverse(double* re, double* im) const
+	{
+		forward(im, re);
+	}
+
+private:
+	int n = 0;
+	std::vector<int> reversed;
+	std::vector<double> twiddleRe,
+		twiddleIm;
+};
@@ -0,0 +1,292 @@
+#pragma once
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "constants.h"
+#include "LookupTable.h"
+
+// Static curve of the compressor: attenuation = dbtoa(ratio * min(0, threshold - level))
+// with an optional quadratic soft knee of width knee (dB) centred on the threshold.
+//
+// The curve is precomputed into a table indexed by a cheap log2 of the detector level,
+// so evaluating the gain costs one interpolation instead of a log, an exp and branches.
+// Tables are built on a worker thread and handed to the audio thread through a triple
+// buffer, so the audio thread never waits and never sees a table being written. Requests
+// are a flag the worker polls, posting one is a store. One worker serves every computer in
+// the process, started with the first and stopped with the last.
+//
+// A synchronous computer (offline processing) builds the table in tableFor instead, so
+// which curve a block uses doesn't depend on the worker's timing.
+class GainComputer {
+public:
+	struct Settings {
+		double threshold = 0,
+			ratio = 0,
+			knee = 0;
+
+		bool operator==(const Settings& other) const = default;
+	};
+
+	// Table covers 2^-20 (-120 dB) to 2^20 (+120 dB) with 32 points per octave, the top for the
+	// Input gain and the sidechain EQ's boosts stacked on a hot signal.
+	static constexpr int MIN_OCTAVE = -20;
+	static constexpr int MAX_OCTAVE = 20;
+	static constexpr int POINTS_PER_OCTAVE = 32;
+	static constexpr size_t TABLE_SIZE = (MAX_OCTAVE - MIN_OCTAVE) * POINTS_PER_OCTAVE + 1;
+
+	using Table = LookupTable<double, TABLE_SIZE>;
+
+	// How often the worker looks for requests.
+	static constexpr std::chrono::milliseconds POLL_INTERVAL { 2 };
+
+	GainComputer()
+	{
+		Worker& worker = sharedWorker();
+		std::lock_guard<std::mutex> lifecycle(worker.lifecycleMutex);
+
+		{
+			std::lock_guard<std::mutex> lock(worker.registryMutex);
+			worker.computers.push_back(this);
+		}
+
+		if (!worker.thread.joinable())
+		{
+			worker.quit.store(false);
+			worker.thread = std::thread(run);
+		}
+	}
+
+	~GainComputer()
+	{
+		Worker& worker = sharedWorker();
+		std::lock_guard<std::mutex> lifecycle(worker.lifecycleMutex);
+		bool last;
+
+		// Waits for the worker to be done with this computer.
+		{
+			std::lock_guard<std::mutex> lock(worker.registryMutex);
+			worker.computers.erase(std::find(worker.computers.begin(), worker.computers.end(), this));
+			last = worker.computers.empty();
+		}
+
+		if (last)
+		{
+			worker.quit.store(true);
+			worker.thread.join();
+		}
+	}
+
+	GainComputer(const GainComputer&) = delete;
+	GainComputer& operator=(const GainComputer&) = delete;
+
+	// Not while processing.
+	void setSynchronous(bool isSynchronous)
+	{
+		synchronous = isSynchronous;
+	}
+
+	// Gain reduction in dB for a level in dB.
+	static inline double gainReduction(const double levelDb, const double threshold, const double ratio, const double knee)
+	{
+		const double overshoot = levelDb - threshold;
+
+		if (2.0 * overshoot <= -knee)
+			return 0.0;
+
+		if (2.0 * overshoot >= knee)
+			return -ratio * overshoot;
+
+		const double x = overshoot + 0.5 * knee;
+		return -ratio * x * x / (2.0 * knee);
+	}
+
+	// Analytic gain, used while the table doesn't match the current settings.
+	static inline double gain(const double level, const double threshold, const double ratio, const double knee)
+	{
+		return dbtoa(gainReduction(atodb(level), threshold, ratio, knee));
+	}
+
+	// Approximate log2, exact at powers of two and linear in between.
+	static inline double fastLog2(const double x)
+	{
+		const uint64_t bits = std::bit_cast<uint64_t>(x);
+		const double exponent = double(int((bits >> 52) & 0x7FF) - 1023);
+		const double mantissa = std::bit_cast<double>((bits & 0x000FFFFFFFFFFFFFull) | 0x3FF0000000000000ull);
+
+		return exponent + mantissa - 1.0;
+	}
+
+	// Inverse of fastLog2.
+	static inline double fastExp2(const double x)
+	{
+		const double exponent = floor(x);
+		return ldexp(1.0 + (x - exponent), int(exponent));
+	}
+
+	// Analytic gain through fastLog2 and fastExp2, within about 1 dB of gain. Used by the Eco quality.
+	static inline double fastGain(const double level, const double threshold, const double ratio, const double knee)
+	{
+		constexpr double decibelsPerOctave = 6.020599913279624;
+		return fastExp2(gainReduction(fastLog2(level) * decibelsPerOctave, threshold, ratio, knee) * (1.0 / decibelsPerOctave));
+	}
+
+	// Audio thread. Returns the table for the given settings, or nullptr if it isn't
+	// ready yet, in which case a rebuild is requested from the worker. Synchronous
+	// computers always return one.
+	inline Table* tableFor(const Settings& settings)
+	{
+		if (middle.load(std::memory_order_acquire) & FRESH)
+			front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+
+		if (slots[front].valid && slots[front].settings == settings)
+			return &slots[front].table;
+
+		// The worker only writes the back slot.
+		if (synchronous)
+		{
+			build(slots[front], settings);
+			return &slots[front].table;
+		}
+
+		if (!(settings == lastRequest))
+		{
+			lastRequest = settings;
+			request(settings);
+		}
+
+		return nullptr;
+	}
+
+	static inline double lookup(const Table& table, const double level)
+	{
+		constexpr double scale = 1.0 / double(MAX_OCTAVE - MIN_OCTAVE);
+		const double index = std::clamp((fastLog2(level) - MIN_OCTAVE) * scale, 0.0, 1.0);
+
+		return table.lookup(index);
+	}
+
+private:
+	struct Slot {
+		Table table;
+		Settings settings;
+		bool valid = false;
+	};
+
+	static constexpr int INDEX = 3;
+	static constexpr int FRESH = 4;
+
+	void request(const Settings& settings)
+	{
+		// Single writer seqlock, read back by the worker.
+		const uint32_t sequence = requestSequence.load(std::memory_order_relaxed);
+		requestSequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		requestedThreshold.store(settings.threshold, std::memory_order_relaxed);
+		requestedRatio.store(settings.ratio, std::memory_order_relaxed);
+		requestedKnee.store(settings.knee, std::memory_order_relaxed);
+
+		requestSequence.store(sequence + 2, std::memory_order_release);
+		pending.store(true, std::memory_order_release);
+	}
+
+	bool readRequest(Settings& settings)
+	{
+		const uint32_t before = requestSequence.load(std::memory_order_acquire);
+
+		settings.threshold = requestedThreshold.load(std::memory_order_relaxed);
+		settings.ratio = requestedRatio.load(std::memory_order_relaxed);
+		settings.knee = requestedKnee.load(std::memory_order_relaxed);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return (before & 1) == 0 && before == requestSequence.load(std::memory_order_relaxed);
+	}
+
+	void build(Slot& slot, const Settings& settings)
+	{
+		for (size_t i = 0; i < TABLE_SIZE; ++i)
+		{
+			const double octave = MIN_OCTAVE + double(i) / double(POINTS_PER_OCTAVE);
+			slot.table.table[i] = gain(fastExp2(octave), settings.threshold, settings.ratio, settings.knee);
+		}
+
+		slot.settings = settings;
+		slot.valid = true;
+	}
+
+	// Worker.
+	void service()
+	{
+		Settings settings;
+
+		// A request torn by a newer one is read with the newer one, which sets pending again.
+		if (pending.exchange(false, std::memory_order_acquire) && readRequest(settings) && !(hasBuilt && settings == built))
+		{
+			build(slots[back], settings);
+			back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+
+			built = settings;
+			hasBuilt = true;
+		}
+	}
+
+	// The registry lock is held by the worker while it services the computers, the lifecycle
+	// lock orders starting and stopping it.
+	struct Worker {
+		std::mutex lifecycleMutex,
+			registryMutex;
+		std::vector<GainComputer*> computers;
+		std::atomic<bool> quit = false;
+		std::thread thread;
+	};
+
+	// Never destroyed, a computer outliving static destruction would find it gone.
+	static Worker& sharedWorker()
+	{
+		static Worker* worker = new Worker();
+		return *worker;
+	}
+
+	static void run()
+	{
+		Worker& worker = sharedWorker();
+
+		while (!worker.quit.load())
+		{
+			{
+				std::lock_guard<std::mutex> lock(worker.registryMutex);
+
+				for (GainComputer* computer : worker.computers)
+					computer->service();
+			}
+
+			std::this_thread::sleep_for(POLL_INTERVAL);
+		}
+	}
+
+	Slot slots[3];
+
+	// Triple buffer: the audio thread owns front, the worker owns back.
+	std::atomic<int> middle = 1;
+	int front = 0;
+	int back = 2;
+
+	Settings lastRequest = { NAN, NAN, NAN };
+
+	std::atomic<uint32_t> requestSequence = 0;
+	std::atomic<double> requestedThreshold = 0,
+		requestedRatio = 0,
+		requestedKnee = 0;
+
+	std::atomic<bool> pending = false;
+	bool synchronous = false;
+
+	// Worker only, the last table it built.
+	Settings built;
+	bool hasBuilt = false;
+};
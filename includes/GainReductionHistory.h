@@ -0,0 +1,142 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Gain reduction and level history for the editor's history view.
+//
+// The processor summarises every FRAME_SAMPLES samples into a Frame and sends the frames to the
+// controller in Blocks through the data exchange. The controller keeps them in a min/max pyramid:
+// an entry of level k summarises 2^k frames, so any range of frames is the union of at most two
+// entries per level. Drawing at any zoom or size costs a few entries per column and never goes
+// back over the frames.
+namespace GainReductionHistory {
+	static constexpr int FRAME_SAMPLES = 32;
+
+	// The level is the peak of every PEAK_SAMPLES samples, a frame holds the quietest and the loudest of them.
+	static constexpr int PEAK_SAMPLES = 8;
+
+	struct Frame {
+		// Smallest and largest gain reduction (positive dB) and peak level (dB) over the frame.
+		// Gain reduction is taken per sample, level per PEAK_SAMPLES.
+		float reductionMin,
+			reductionMax,
+			levelMin,
+			levelMax;
+
+		static Frame empty()
+		{
+			return { 1e30f, -1e30f, 1e30f, -1e30f };
+		}
+
+		bool isEmpty() const
+		{
+			return reductionMin > reductionMax;
+		}
+
+		void add(const Frame& other)
+		{
+			reductionMin = (std::min)(reductionMin, other.reductionMin);
+			reductionMax = (std::max)(reductionMax, other.reductionMax);
+			levelMin = (std::min)(levelMin, other.levelMin);
+			levelMax = (std::max)(levelMax, other.levelMax);
+		}
+	};
+
+	// One data exchange block from the processor.
+	struct Block {
+		static constexpr int MAX_FRAMES = 256;
+
+		double sampleRate;
+		uint32_t numFrames;
+
+		// Processor load when the block was sent, see LoadMeter.
+		float load,
+			loadPeak;
+
+		Frame frames[MAX_FRAMES];
+	};
+
+	// Lives on the UI thread.
+	class Pyramid {
+	public:
+		// 2^16 frames, about 43 s at 48 kHz. The coarsest level summarises 2^11 frames.
+		static constexpr int CAPACITY_BITS = 16;
+		static constexpr int LEVELS = 12;
+		static constexpr uint64_t CAPACITY = uint64_t(1) << CAPACITY_BITS;
+
+		Pyramid()
+		{
+			for (int k = 0; k < LEVELS; ++k)
+				levels[k].resize(CAPACITY >> k, Frame::empty());
+		}
+
+		void push(const Frame& frame)
+		{
+			levels[0][count & mask(0)] = frame;
+			++count;
+
+			// Complete the entries that end with this frame.
+			for (int k = 1; k < LEVELS && (count & ((uint64_t(1) << k) - 1)) == 0; ++k)
+			{
+				const uint64_t index = (count >> k) - 1;
+				Frame entry = at(k - 1, 2 * index);
+
+				entry.add(at(k - 1, 2 * index + 1));
+				levels[k][index & mask(k)] = entry;
+			}
+		}
+
+		// Summary of the frames [first, last), empty for frames that are gone or not there yet.
+		Frame range(int64_t first, int64_t last) const
+		{
+			first = (std::max)(first, int64_t(oldest()));
+			last = (std::min)(last, int64_t(count));
+
+			Frame result = Frame::empty();
+
+			while (first < last)
+			{
+				// Largest entry starting at first that fits in the range.
+				int k = 0;
+
+				while (k + 1 < LEVELS && (first & ((int64_t(2) << k) - 1)) == 0 && first + (int64_t(2) << k) <= last)
+					++k;
+
+				result.add(at(k, uint64_t(first) >> k));
+				first += int64_t(1) << k;
+			}
+
+			return result;
+		}
+
+		// Frames pushed so far, the newest one is size() - 1.
+		uint64_t size() const { return count; }
+
+		uint64_t oldest() const { return count > CAPACITY ? count - CAPACITY : 0; }
+
+		// Clears the history when the sample rate changes, the frames wouldn't line up in time.
+		void setSampleRate(double sr)
+		{
+			if (sr == sampleRate)
+				return;
+
+			sampleRate = sr;
+			count = 0;
+			++generation;
+		}
+
+		double sampleRate = 0.0;
+
+		// Changes whenever the history restarts, so views know to redraw everything.
+		uint32_t generation = 0;
+
+	private:
+		static constexpr uint64_t mask(int level) { return (CAPACITY >> level) - 1; }
+
+		const Frame& at(int level, uint64_t index) const { return levels[level][index & mask(level)]; }
+
+		std::vector<Frame> levels[LEVELS];
+		uint64_t count = 0;
+	};
+}
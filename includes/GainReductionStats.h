@@ -0,0 +1,102 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+// Gain reduction statistics gathered by the detector-only analysis (Kwire2Processor::analyse).
+// Gain reduction is in positive dB, binned in HISTOGRAM_STEP dB steps, the last bin holds everything above.
+struct GainReductionStats {
+	static constexpr double HISTOGRAM_STEP = 0.5;
+	static constexpr int HISTOGRAM_SIZE = 97;
+
+	uint64_t histogram[HISTOGRAM_SIZE] = { 0 };
+	uint64_t samples = 0;
+	uint64_t samplesAboveThreshold = 0;
+	double sumReduction = 0.0;
+	double maxReduction = 0.0;
+
+	// Gain reduction in dB for a gain up to 1, or minus the level in dB of any positive value. The exponent comes from the bits and log2 of the
+	// mantissa from a short atanh series, accurate to about 1e-4 dB and cheap enough to vectorize.
+	static inline double reductionDb(const double gain)
+	{
+		const uint64_t bits = std::bit_cast<uint64_t>((std::max)(gain, 1e-12));
+		const double exponent = double(int((bits >> 52) & 0x7FF) - 1023);
+		const double mantissa = std::bit_cast<double>((bits & 0x000FFFFFFFFFFFFFull) | 0x3FF0000000000000ull);
+
+		const double t = (mantissa - 1.0) / (mantissa + 1.0);
+		const double t2 = t * t;
+		const double log2Mantissa = 2.0 * 1.4426950408889634 * t * (1.0 + t2 * (1.0 / 3.0 + t2 * (1.0 / 5.0 + t2 * (1.0 / 7.0))));
+
+		return -6.020599913279624 * (exponent + log2Mantissa);
+	}
+
+	// Envelope as applied to the signal, 1 for no gain reduction.
+	void addEnvelope(const double* envelope, const int count)
+	{
+		double minGain = 1.0;
+
+		for (int s = 0; s < count; ++s)
+		{
+			const double reduction = reductionDb(envelope[s]);
+			const int bin = (std::min)(int(reduction * (1.0 / HISTOGRAM_STEP)), HISTOGRAM_SIZE - 1);
+
+			histogram[(std::max)(bin, 0)]++;
+			sumReduction += reduction;
+			minGain = (std::min)(minGain, envelope[s]);
+		}
+
+		maxReduction = (std::max)(maxReduction, reductionDb(minGain));
+		samples += count;
+	}
+
+	// Detector level as the gain computer sees it, against the threshold in dB. Counted whatever
+	// the ratio and the knee make of it.
+	void addDetectorLevel(const double* level, const double* threshold, const int count)
+	{
+		int above = 0;
+
+		for (int s = 0; s < count; ++s)
+			above += -reductionDb(level[s]) > threshold[s];
+
+		samplesAboveThreshold += above;
+	}
+
+	void merge(const GainReductionStats& other)
+	{
+		for (int i = 0; i < HISTOGRAM_SIZE; ++i)
+			histogram[i] += other.histogram[i];
+
+		samples += other.samples;
+		samplesAboveThreshold += other.samplesAboveThreshold;
+		sumReduction += other.sumReduction;
+		maxReduction = (std::max)(maxReduction, other.maxReduction);
+	}
+
+	double averageReduction() const
+	{
+		return samples ? sumReduction / double(samples) : 0.0;
+	}
+
+	double fractionAboveThreshold() const
+	{
+		return samples ? double(samplesAboveThreshold) / double(samples) : 0.0;
+	}
+
+	// Upper edge of the bin holding the given fraction of samples, in dB, at most the maximum.
+	double percentile(const double fraction) const
+	{
+		const uint64_t target = uint64_t(fraction * double(samples));
+		uint64_t count = 0;
+
+		for (int i = 0; i < HISTOGRAM_SIZE; ++i)
+		{
+			count += histogram[i];
+
+			if (count > target)
+				return (std::min)((i + 1) * HISTOGRAM_STEP, maxReduction);
+		}
+
+		return maxReduction;
+	}
+};
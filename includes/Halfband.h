@@ -0,0 +1,141 @@
+#pragma once
+
+// 2x up and downsampling with polyphase IIR halfband filters: two chains of first order
+// allpass sections running at the base rate (Laurent de Soras' HIIR structure).
+// 8 coefficients with a 0.04 transition band reject images and aliases by about 100 dB.
+// There's no latency to report, the group delay is about 1.5 samples per direction at low frequencies.
+
+namespace Halfband {
+	static constexpr int NUM_COEFFICIENTS = 8;
+
+	static constexpr double coefficients[NUM_COEFFICIENTS] = {
+		0.0406334609, 0.1505051290, 0.3007570560, 0.4607745050,
+		0.6095243149, 0.7385038411, 0.8492238104, 0.9497427837
+	};
+
+	// One of the two polyphase paths, every other coefficient starting at first.
+	template <int first>
+	struct AllpassChain {
+		static constexpr int SIZE = NUM_COEFFICIENTS / 2;
+
+		inline double process(double input)
+		{
+			for (int i = 0; i < SIZE; ++i)
+			{
+				const double output = (input - y[i]) * coefficients[first + 2 * i] + x[i];
+				x[i] = input;
+				y[i] = output;
+				input = output;
+			}
+
+			return input;
+		}
+
+		void reset()
+		{
+			for (int i = 0; i < SIZE; ++i)
+				x[i] = y[i] = 0.0;
+		}
+
+		double stateSum() const
+		{
+			double sum = 0.0;
+
+			for (int i = 0; i < SIZE; ++i)
+				sum += x[i] + y[i];
+
+			return sum;
+		}
+
+		double x[SIZE] = { 0.0 };
+		double y[SIZE] = { 0.0 };
+	};
+
+	// Writes 2 * numSamples samples to output.
+	class Upsampler {
+	public:
+		inline void process(const double* input, double* output, int numSamples)
+		{
+			for (int s = 0; s < numSamples; ++s)
+			{
+				output[2 * s] = even.process(input[s]);
+				output[2 * s + 1] = odd.process(input[s]);
+			}
+		}
+
+		void reset()
+		{
+			even.reset();
+			odd.reset();
+		}
+
+		double stateSum() const
+		{
+			return even.stateSum() + odd.stateSum();
+		}
+
+	private:
+		AllpassChain<0> even;
+		AllpassChain<1> odd;
+	};
+
+	// Reads 2 * numSamples samples from input.
+	class Downsampler {
+	public:
+		inline void process(const double* input, double* output, int numSamples)
+		{
+			for (int s = 0; s < numSamples; ++s)
+				output[s] = 0.5 * (even.process(input[2 * s + 1]) + odd.process(input[2 * s]));
+		}
+
+		void reset()
+		{
+			even.reset();
+			odd.reset();
+		}
+
+		double stateSum() const
+		{
+			return even.stateSum() + odd.stateSum();
+		}
+
+	private:
+		AllpassChain<0> even;
+		AllpassChain<1> odd;
+	};
+
+	// Up and back down with nothing in between, the phase the pair gives a signal at the base rate.
+	// Lines a signal up with one that went through an Upsampler and a Downsampler, blended in by
+	// mix (0 to 1) per sample.
+	class RoundTrip {
+	public:
+		template <typename SampleType>
+		inline void process(const SampleType* input, SampleType* output, int numSamples, const double* mix)
+		{
+			for (int s = 0; s < numSamples; ++s)
+			{
+				const double x = static_cast<double>(input[s]);
+				const double y = 0.5 * (downEven.process(upOdd.process(x)) + downOdd.process(upEven.process(x)));
+
+				output[s] = static_cast<SampleType>(x + mix[s] * (y - x));
+			}
+		}
+
+		void reset()
+		{
+			upEven.reset();
+			upOdd.reset();
+			downEven.reset();
+			downOdd.reset();
+		}
+
+		double stateSum() const
+		{
+			return upEven.stateSum() + upOdd.stateSum() + downEven.stateSum() + downOdd.stateSum();
+		}
+
+	private:
+		AllpassChain<0> upEven, downEven;
+		AllpassChain<1> upOdd, downOdd;
+	};
+}
@@ -0,0 +1,131 @@
+#pragma once
+#define _USE_MATH_DEFINES
+#include <algorithm>
+#include <bit>
+#include <math.h>
+#include <vector>
+
+#include "FFT.h"
+#include "PartitionedConvolver.h"
+
+// Linear phase version of the detector's highpass, for the crossover's Linear Phase mode.
+//
+// The kernel has the magnitude of the TPTSVF highpass at the same cutoff and damping, made zero
+// phase, centred and windowed to about KERNEL_SECONDS, and runs on a PartitionedConvolver. The
+// detector then sees no phase shift around the crossover, for latency() samples of delay: half the
+// kernel and a partition. Cutoffs low enough for the filter's response to outlast the kernel come
+// out with a gentler slope.
+//
+// The kernel is redesigned when the cutoff moves by more than REDESIGN_TOLERANCE, at most once per
+// block: one transform of the kernel's length and one per partition, no allocation.
+class LinearPhaseCrossover {
+public:
+	static constexpr double KERNEL_SECONDS = 0.05;
+	static constexpr double REDESIGN_TOLERANCE = 0.005;
+
+	// Taps at a sample rate, the power of two from KERNEL_SECONDS.
+	static int kernelSize(double sampleRate)
+	{
+		return int(std::bit_ceil(unsigned(ceil(KERNEL_SECONDS * sampleRate))));
+	}
+
+	static int latency(double sampleRate, int partition)
+	{
+		return kernelSize(sampleRate) / 2 + partition;
+	}
+
+	// Allocates. partition is a power of two.
+	void prepare(double sampleRate, int partition)
+	{
+		inverseSampleRate = 1.0 / sampleRate;
+		N = kernelSize(sampleRate);
+		B = partition;
+
+		transform.prepare(N);
+		convolver.prepare(B, N);
+
+		warp.assign(N / 2 + 1, 0.0);
+		window.assign(N, 0.0);
+		designRe.assign(N, 0.0);
+		designIm.assign(N, 0.0);
+
+		// Bilinear frequency warping of each bin, as the filter's prewarped cutoff sees it.
+		for (int k = 0; k < N / 2; ++k)
+			warp[k] = tan(M_PI * k / N);
+
+		// Blackman, centred on N / 2.
+		for (int t = 0; t < N; ++t)
+			window[t] = 0.42 - 0.5 * cos(2.0 * M_PI * t / N) + 0.08 * cos(4.0 * M_PI * t / N);
+
+		designedCutoff = 0.0;
+	}
+
+	void reset()
+	{
+		convolver.reset();
+	}
+
+	int latency() const
+	{
+		return N / 2 + B;
+	}
+
+	// Same range and damping as TPTSVF::setCutoff and setResonance.
+	void setCutoff(double cutoffFrequency, double resonance)
+	{
+		const double cutoff = std::clamp(cutoffFrequency, 5.0, 20000.0);
+
+		if (abs(cutoff - designedCutoff) <= REDESIGN_TOLERANCE * designedCutoff && resonance == designedResonance)
+			return;
+
+		designedCutoff = cutoff;
+		designedResonance = resonance;
+
+		const double g = tan(M_PI * cutoff * inverseSampleRate);
+		const double R2 = 2.0 - 2.0 * resonance;
+
+		// |s^2 / (s^2 + R2 s + 1)| at s = j w, times (-1)^k to centre the response on N / 2.
+		for (int k = 0; k < N / 2; ++k)
+		{
+			const double w = warp[k] / g;
+			const double magnitude = w * w / sqrt((1.0 - w * w) * (1.0 - w * w) + R2 * R2 * w * w);
+
+			designRe[k] = k & 1 ? -magnitude : magnitude;
+		}
+
+		designRe[N / 2] = 1.0;
+
+		for (int k = N / 2 + 1; k < N; ++k)
+			designRe[k] = designRe[N - k];
+
+		std::fill(designIm.begin(), designIm.end(), 0.0);
+		transform.inverse(designRe.data(), designIm.data());
+
+		for (int t = 0; t < N; ++t)
+			designRe[t] *= window[t] / N;
+
+		convolver.setKernel(designRe.data(), N);
+	}
+
+	// Both channels, out lagging in by latency().
+	void process(const double* inL, const double* inR, double* outL, double* outR, int samples)
+	{
+		convolver.process(inL, inR, outL, outR, samples);
+	}
+
+private:
+	double inverseSampleRate = 1.0 / 44100.0;
+	int N = 0,
+		B = 0;
+
+	FFT transform;
+	PartitionedConvolver convolver;
+
+	std::vector<double> warp,
+		window,
+		designRe,
+		designIm;
+
+	double designedCutoff = 0.0,
+		designedResonance = 0.0;
+};
@@ -0,0 +1,71 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+// Processing time of an instance relative to the real time of the audio it processed: 1 for blocks
+// taking as long to process as they last.
+//
+// start and stop bracket process() on the audio thread, one steady clock read each. The average
+// and the decaying peak are published together in one atomic word, readable from any thread: the
+// controller gets them with the gain reduction history, offline harnesses from the processor.
+class LoadMeter {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// Time constant of the average and release time of the peak, in seconds of audio.
+	static constexpr double AVERAGE_SECONDS = 0.5;
+	static constexpr double PEAK_SECONDS = 3.0;
+
+	struct Reading {
+		float average = 0.0f,
+			peak = 0.0f;
+	};
+
+	inline Clock::time_point start() const
+	{
+		return Clock::now();
+	}
+
+	void stop(Clock::time_point started, int samples, double sampleRate)
+	{
+		if (samples <= 0 || sampleRate <= 0.0)
+			return;
+
+		const double budget = samples / sampleRate;
+		const double load = std::chrono::duration<double>(Clock::now() - started).count() / budget;
+
+		average += (load - average) * (1.0 - std::exp(-budget / AVERAGE_SECONDS));
+		peak = (std::max)(load, peak * std::exp(-budget / PEAK_SECONDS));
+
+		publish();
+	}
+
+	void reset()
+	{
+		average = 0.0;
+		peak = 0.0;
+		publish();
+	}
+
+	Reading reading() const
+	{
+		return std::bit_cast<Reading>(published.load(std::memory_order_relaxed));
+	}
+
+private:
+	void publish()
+	{
+		published.store(std::bit_cast<uint64_t>(Reading { float(average), float(peak) }), std::memory_order_relaxed);
+	}
+
+	static_assert(sizeof(Reading) == sizeof(uint64_t));
+
+	double average = 0.0,
+		peak = 0.0;
+
+	std::atomic<uint64_t> published { 0 };
+};
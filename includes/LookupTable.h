@@ -1,22 +1,29 @@
 #pragma once
 
+#include <new>
+
+// Storage is aligned to cache lines, so a table shared between threads doesn't
+// share its first and last lines with anything else.
 template <typename T, size_t size>
 struct LookupTable {
+    static constexpr std::align_val_t ALIGNMENT { 64 };
+
     LookupTable()
     {
-        table = (T*)calloc(size, sizeof(T));
-
-        if (table == nullptr) 
-            throw std::bad_alloc();
+        table = static_cast<T*>(::operator new(size * sizeof(T), ALIGNMENT));
+        std::fill(table, table + size, T(0));
     }
 
+    LookupTable(const LookupTable&) = delete;
+    LookupTable& operator=(const LookupTable&) = delete;
+
     ~LookupTable()
     {
-        free(table);
+        ::operator delete(table, ALIGNMENT);
     }
 
     // Index is normalised.
-    T lookup(T index)
+    T lookup(T index) const
     {
         assert(index >= 0.0 && index <= 1.0);
 
@@ -31,4 +38,4 @@ struct LookupTable {
     }
 
     T* table = nullptr;
-};
\ No newline at end of file
+};
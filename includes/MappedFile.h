@@ -0,0 +1,133 @@
+#pragma once
+
+#include <Windows.h>
+#include <cstdint>
+#include <filesystem>
+
+// File access through a sliding memory-mapped window.
+// Only the window is mapped, so files of any size are streamed without being loaded whole.
+class MappedFile {
+public:
+	enum Mode {
+		Read,
+		Write,
+		Update	// Writes into an existing file, eg. one being written by another thread.
+	};
+
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile()
+	{
+		close();
+	}
+
+	// Write mode creates (or truncates) the file with the given size.
+	bool open(const std::filesystem::path& path, Mode openMode, uint64_t writeSize = 0)
+	{
+		close();
+		mode = openMode;
+
+		// Written files can be opened again for update, their views of the file are coherent.
+		const DWORD access = mode == Read ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE;
+		const DWORD share = mode == Read ? FILE_SHARE_READ : FILE_SHARE_READ | FILE_SHARE_WRITE;
+		const DWORD disposition = mode == Write ? CREATE_ALWAYS : OPEN_EXISTING;
+
+		file = CreateFileW(path.wstring().c_str(), access, share, nullptr, disposition, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		if (mode != Write)
+		{
+			LARGE_INTEGER size;
+
+			if (!GetFileSizeEx(file, &size))
+				return false;
+
+			fileSize = uint64_t(size.QuadPart);
+		}
+		else
+		{
+			fileSize = writeSize;
+		}
+
+		// Empty files can't be mapped, but there's nothing to read or write either.
+		if (fileSize == 0)
+			return true;
+
+		mapping = CreateFileMappingW(file, nullptr, mode == Read ? PAGE_READONLY : PAGE_READWRITE,
+			DWORD(fileSize >> 32), DWORD(fileSize & 0xFFFFFFFF), nullptr);
+
+		return mapping != nullptr;
+	}
+
+	void close()
+	{
+		unmap();
+
+		if (mapping)
+			CloseHandle(mapping);
+
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+
+		mapping = nullptr;
+		file = INVALID_HANDLE_VALUE;
+		fileSize = 0;
+	}
+
+	// Pointer to [offset, offset + length), valid until the next call to map or close.
+	uint8_t* map(uint64_t offset, size_t length)
+	{
+		if (offset + length > fileSize)
+			return nullptr;
+
+		if (view && offset >= viewOffset && offset + length <= viewOffset + viewLength)
+			return view + (offset - viewOffset);
+
+		unmap();
+
+		static const uint64_t granularity = allocationGranularity();
+
+		viewOffset = offset - offset % granularity;
+		viewLength = size_t((std::min)(fileSize - viewOffset, (std::max)(uint64_t(WINDOW_SIZE), offset + length - viewOffset)));
+
+		view = static_cast<uint8_t*>(MapViewOfFile(mapping, mode == Read ? FILE_MAP_READ : FILE_MAP_WRITE,
+			DWORD(viewOffset >> 32), DWORD(viewOffset & 0xFFFFFFFF), viewLength));
+
+		return view ? view + (offset - viewOffset) : nullptr;
+	}
+
+	uint64_t size() const { return fileSize; }
+
+private:
+	static constexpr size_t WINDOW_SIZE = 64 << 20;
+
+	static uint64_t allocationGranularity()
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return info.dwAllocationGranularity;
+	}
+
+	void unmap()
+	{
+		if (view)
+			UnmapViewOfFile(view);
+
+		view = nullptr;
+		viewOffset = 0;
+		viewLength = 0;
+	}
+
+	Mode mode = Read;
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+	uint64_t fileSize = 0;
+
+	uint8_t* view = nullptr;
+	uint64_t viewOffset = 0;
+	size_t viewLength = 0;
+};
@@ -0,0 +1,154 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+#include "constants.h"
+#include "parameters.h"
+
+// Modulation of control rate parameters by MIDI CCs, an LFO and an input envelope follower.
+//
+// Every source used by a slot is evaluated once per control point of the block into its own row,
+// in one pass. A modulated destination adds its slots' rows to its normalised value at its control
+// points (Kwire2Processor::renderParameter), so the cost grows with the sources and control points,
+// not with the destinations' samples.
+class Modulation {
+public:
+	enum Source {
+		Off,
+		ModWheel,
+		Expression,
+		Lfo,
+		Follower,
+		NumSources
+	};
+
+	static constexpr int SLOTS = 4;
+
+	// Follower range, mapped to 0 - 1.
+	static constexpr double FOLLOWER_FLOOR_DB = -60.0;
+
+	struct Slot {
+		Source source = Off;
+		int destination = -1;
+
+		// Per sample amount in normalised units, -1 to 1.
+		const double* amount = nullptr;
+	};
+
+	void setSampleRate(double sr)
+	{
+		sampleRate = sr;
+	}
+
+	void reset()
+	{
+		lfoPhase = 0.0;
+		follower = 0.0;
+		segmentPeak = 0.0;
+	}
+
+	void setSlot(int index, Source source, int destination, const double* amount)
+	{
+		slots[index] = { source, destination, amount };
+	}
+
+	inline bool modulates(ParamID id) const
+	{
+		for (const Slot& slot : slots)
+		{
+			if (slot.source != Off && slot.destination == int(id))
+				return true;
+		}
+
+		return false;
+	}
+
+	// Control points are at first, first + interval, ... within the block. Rows of the internal
+	// parameters are per sample, lfoRate in Hz and followerRelease in ms.
+	template <typename SampleType>
+	void evaluate(SampleType** input, int samples, int first, int interval,
+		const double* modWheel, const double* expression, const double* lfoRate, const double* followerRelease)
+	{
+		firstPoint = first;
+		pointInterval = interval;
+		const int points = first < samples ? (samples - 1 - first) / interval + 1 : 0;
+
+		bool used[NumSources] = { false };
+
+		for (const Slot& slot : slots)
+			used[slot.source] |= slot.destination >= 0;
+
+		if (used[ModWheel])
+		{
+			for (int j = 0; j < points; ++j)
+				values[ModWheel][j] = modWheel[first + j * interval];
+		}
+
+		if (used[Expression])
+		{
+			for (int j = 0; j < points; ++j)
+				values[Expression][j] = expression[first + j * interval];
+		}
+
+		// Bipolar sine, advanced by one control period per point.
+		if (used[Lfo])
+		{
+			for (int j = 0; j < points; ++j)
+			{
+				values[Lfo][j] = sin(2.0 * M_PI * lfoPhase);
+
+				lfoPhase += lfoRate[first + j * interval] * double(interval) / sampleRate;
+				lfoPhase -= floor(lfoPhase);
+			}
+		}
+
+		// Peak of the samples since the previous control point, released exponentially.
+		if (used[Follower])
+		{
+			int point = 0;
+
+			for (int s = 0; s < samples; ++s)
+			{
+				segmentPeak = max(segmentPeak, max(abs(double(input[0][s])), abs(double(input[1][s]))));
+
+				if (point < points && s == first + point * interval)
+				{
+					const double release = exp(-double(interval) / max(1.0, followerRelease[s] * 0.001 * sampleRate));
+					const double level = std::clamp(1.0 - atodb(max(segmentPeak, 1e-6)) / FOLLOWER_FLOOR_DB, 0.0, 1.0);
+
+					follower = max(level, follower * release);
+					values[Follower][point++] = follower;
+					segmentPeak = 0.0;
+				}
+			}
+		}
+	}
+
+	// Offset of the normalised value of id at the control point at sample s of the block.
+	inline double offset(ParamID id, int s) const
+	{
+		const int point = (s - firstPoint) / pointInterval;
+		double sum = 0.0;
+
+		for (const Slot& slot : slots)
+		{
+			if (slot.source != Off && slot.destination == int(id))
+				sum += slot.amount[s] * values[slot.source][point];
+		}
+
+		return sum;
+	}
+
+private:
+	Slot slots[SLOTS];
+
+	// Source values per control point of the block.
+	double values[NumSources][MAX_BUFFER_SIZE] = { { 0.0 } };
+	int firstPoint = 0;
+	int pointInterval = 1;
+
+	double sampleRate = 44100.0;
+	double lfoPhase = 0.0;
+	double follower = 0.0;
+	double segmentPeak = 0.0;
+};
@@ -5,19 +5,30 @@
 #include "pluginterfaces/vst/ivstparameterchanges.h"
 #include <stdlib.h>
 
+#include "constants.h"
+
 using namespace Steinberg;
 using namespace Steinberg::Vst;
 
 struct ParamPointQueue
 {
 public:
+	// Points kept per block. Hosts send a handful; denser automation is merged, see insert.
+	static constexpr int32 MAX_POINTS = 64;
+
+	struct Point {
+		int32 offset;
+		ParamValue value;
+	};
+
 	// This function creates a clean point list from an IParamValueQueue,
-	// meaning no elements share the same sampleOffset.
+	// meaning no elements share the same sampleOffset. Points are kept sorted
+	// in a fixed array, so it doesn't allocate on the audio thread.
 	int32 fromParamQueue(IParamValueQueue* paramQueue)
 	{
 		assert(paramQueue);
 
-		pointQueue.clear();
+		numPoints = 0;
 
 		const int32 points = paramQueue->getPointCount();
 
@@ -26,16 +37,45 @@ public:
 			int32 sampleOffset;
 			ParamValue value;
 
-			// Overwrite previous values at the same offset
 			if (paramQueue->getPoint(i, sampleOffset, value) == Steinberg::kResultOk)
-				pointQueue[sampleOffset] = value;
+				insert(sampleOffset, value);
 		}
 
-		numPoints = pointQueue.size();
-
 		return numPoints;
 	}
 
-	std::map<int32, ParamValue> pointQueue;
+	const Point* begin() const { return pointQueue; }
+	const Point* end() const { return pointQueue + numPoints; }
+
+	Point pointQueue[MAX_POINTS];
 	int32 numPoints = 0;
-};
\ No newline at end of file
+
+private:
+	void insert(int32 sampleOffset, ParamValue value)
+	{
+		// Hosts send points in order, so this is usually an append.
+		int32 i = numPoints;
+
+		while (i > 0 && pointQueue[i - 1].offset > sampleOffset)
+			--i;
+
+		// Overwrite previous values at the same offset
+		if (i > 0 && pointQueue[i - 1].offset == sampleOffset)
+		{
+			pointQueue[i - 1].value = value;
+			return;
+		}
+
+		// Full: the new point replaces its predecessor, so the ramp runs straight to it and the
+		// block still ends on the host's last value.
+		if (numPoints == MAX_POINTS)
+		{
+			pointQueue[(std::max)(i - 1, 0)] = { sampleOffset, value };
+			return;
+		}
+
+		std::copy_backward(pointQueue + i, pointQueue + numPoints, pointQueue + numPoints + 1);
+		pointQueue[i] = { sampleOffset, value };
+		++numPoints;
+	}
+};
@@ -0,0 +1,90 @@
+#pragma once
+#include "constants.h"
+
+// Linear ramp towards a target over a fixed time, or over the samples to a host automation point.
+// Runs per sample rather than per block, so the glide doesn't depend on the host's buffer size.
+class ParamSmoother {
+public:
+	ParamSmoother()
+	{
+		setSampleRate(44100);
+	}
+
+	void setSampleRate(double samplerate)
+	{
+		sampleRate = samplerate;
+		rampSamples = max(1, int(round(rampTime * sampleRate * 0.001)));
+	}
+
+	void setRampTime(double ms)
+	{
+		rampTime = ms;
+		setSampleRate(sampleRate);
+	}
+
+	// Jump to a value without ramping.
+	void reset(double value)
+	{
+		current = target = value;
+		remaining = 0;
+	}
+
+	void setTarget(double value)
+	{
+		if (value == target)
+			return;
+
+		target = value;
+		remaining = rampSamples;
+		step = (target - current) / double(remaining);
+	}
+
+	// Reaches value on the samples-th call to next, with no smoothing of its own.
+	void rampTo(double value, int samples)
+	{
+		if (samples <= 0)
+		{
+			reset(value);
+			return;
+		}
+
+		target = value;
+		remaining = samples;
+		step = (target - current) / double(remaining);
+	}
+
+	inline double next()
+	{
+		if (remaining > 0)
+			current = --remaining == 0 ? target : current + step;
+
+		return current;
+	}
+
+	inline void skip(int samples)
+	{
+		if (samples >= remaining)
+		{
+			current = target;
+			remaining = 0;
+		}
+		else
+		{
+			current += step * samples;
+			remaining -= samples;
+		}
+	}
+
+	inline bool isSettled() const { return remaining == 0; }
+
+	double current = 0,
+		target = 0;
+
+private:
+	double sampleRate = 44100;
+	double rampTime = PARAM_SMOOTHING_TIME;
+	int rampSamples = 1;
+
+	double step = 0;
+	int remaining = 0;
+};
@@ -0,0 +1,149 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+#include "pluginterfaces/vst/vsttypes.h"
+
+#include "CustomParameter.h"
+
+// Display strings of parameter values for the controller. Hosts ask for these constantly while
+// drawing automation lanes and generic editors, so numbers go through to_chars and from_chars
+// on stack buffers and straight to UTF-16, without streams, strings or exceptions.
+namespace ParameterFormat {
+	static constexpr int BUFFER_SIZE = 64;
+
+	inline char lower(const char c)
+	{
+		return c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c;
+	}
+
+	inline bool equalsIgnoringCase(const char* text, const int length, const std::string& other)
+	{
+		if (length != int(other.size()))
+			return false;
+
+		for (int i = 0; i < length; ++i)
+		{
+			if (lower(text[i]) != lower(other[i]))
+				return false;
+		}
+
+		return true;
+	}
+
+	// Writes the display string of a plain value, eg. "-12.00 dB" or "High". Returns its length.
+	inline int format(const CustomParameter& parameter, double plain, char* buffer, const int size)
+	{
+		char* end = buffer + size;
+
+		if (!parameter.valueNames.empty())
+		{
+			const int step = std::clamp(int(lround(plain - parameter.minPlain)), 0, parameter.stepCount);
+			const std::string& name = parameter.valueNames[step];
+			const int length = (std::min)(int(name.size()), size);
+
+			std::copy(name.begin(), name.begin() + length, buffer);
+			return length;
+		}
+
+		const int precision = parameter.stepCount == 0 ? 2 : 0;
+
+		// No "-0.00" for values that round to zero.
+		if (abs(plain) < (precision ? 0.005 : 0.5))
+			plain = 0.0;
+
+		const std::to_chars_result result = std::to_chars(buffer, end, plain, std::chars_format::fixed, precision);
+
+		if (result.ec != std::errc())
+			return 0;
+
+		char* position = result.ptr;
+
+		if (!parameter.units.empty() && end - position > int(parameter.units.size()))
+		{
+			*position++ = ' ';
+			position = std::copy(parameter.units.begin(), parameter.units.end(), position);
+		}
+
+		return int(position - buffer);
+	}
+
+	// ASCII to UTF-16, truncated to fit with its terminator.
+	inline void widen(const char* text, int length, Steinberg::Vst::String128 string)
+	{
+		length = (std::min)(length, 127);
+
+		for (int i = 0; i < length; ++i)
+			string[i] = Steinberg::Vst::TChar(text[i]);
+
+		string[length] = 0;
+	}
+
+	// UTF-16 to ASCII. Fails on anything that can't be part of a value.
+	inline bool narrow(const Steinberg::Vst::TChar* string, char* buffer, const int size, int& length)
+	{
+		for (length = 0; string[length] != 0; ++length)
+		{
+			if (length == size || string[length] > 0x7F)
+				return false;
+
+			buffer[length] = char(string[length]);
+		}
+
+		return true;
+	}
+
+	// Reads a display string back to a plain value: a step name, or a number followed by an optional
+	// k (thousands) and the parameter's units, eg. "1.2k", "1.2 kHz", "-6dB", or "0.05 s" for ms.
+	inline bool parse(const CustomParameter& parameter, const char* text, const int length, double& plain)
+	{
+		const char* first = text;
+		const char* last = text + length;
+
+		while (first < last && *first == ' ') ++first;
+		while (last > first && last[-1] == ' ') --last;
+
+		for (int step = 0; step < int(parameter.valueNames.size()); ++step)
+		{
+			if (equalsIgnoringCase(first, int(last - first), parameter.valueNames[step]))
+			{
+				plain = parameter.minPlain + step;
+				return true;
+			}
+		}
+
+		if (first < last && *first == '+')
+			++first;
+
+		double value;
+		const std::from_chars_result result = std::from_chars(first, last, value);
+
+		if (result.ec != std::errc() || !std::isfinite(value))
+			return false;
+
+		first = result.ptr;
+
+		while (first < last && *first == ' ') ++first;
+
+		if (first < last && lower(*first) == 'k')
+		{
+			value *= 1000.0;
+			++first;
+		}
+
+		const int unitLength = int(last - first);
+
+		if (unitLength > 0 && !equalsIgnoringCase(first, unitLength, parameter.units))
+		{
+			// Times in ms also take seconds.
+			if (parameter.units == "ms" && unitLength == 1 && lower(*first) == 's')
+				value *= 1000.0;
+			else
+				return false;
+		}
+
+		plain = value;
+		return true;
+	}
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+
+#include "parameters.h"
+
+// Parameter state handed from setState to the audio thread.
+//
+// The writer fills a state (normalised values and their mapped real values) and publishes it through a
+// triple buffer. The audio thread picks up the newest state at the start of a block with one exchange,
+// so it never waits and never sees a state being written. A state only carries the ids it writes, the
+// audio thread keeps its own values for the others. States published between two blocks replace each
+// other, so the writer keeps the ids written until one is taken up and each state carries those of
+// the states it replaces.
+//
+// latest holds the newest known normalised values, from either side, for getState and
+// getLatencySamples. The audio thread only records the values it changed itself: the ones it carried
+// over from before a state was taken up would overwrite the state's.
+class ParameterSnapshot {
+public:
+	struct State {
+		double normalised[nTotalParams] = { 0.0 };
+		double real[nTotalParams] = { 0.0 };
+		bool written[nTotalParams] = { false };
+
+		void set(ParamID id, double value)
+		{
+			normalised[id] = value;
+			written[id] = true;
+		}
+	};
+
+	// Writer, one at a time. Returns the writer's state to set values in, with the ids written since
+	// the audio thread last took a state up.
+	State& beginWrite()
+	{
+		if (!(middle.load(std::memory_order_acquire) & FRESH))
+			std::fill(pending.written, pending.written + nTotalParams, false);
+
+		return pending;
+	}
+
+	// Writer. Hands the state filled since beginWrite to the audio thread.
+	void publish()
+	{
+		slots[back] = pending;
+
+		for (int32 id = 0; id < nTotalParams; ++id)
+		{
+			if (pending.written[id])
+				latest[id].store(pending.normalised[id], std::memory_order_relaxed);
+		}
+
+		back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+	}
+
+	// Audio thread. Returns the newest published state, or nullptr if there's none since the last call.
+	// The caller takes up the written values.
+	inline const State* read()
+	{
+		if (!(middle.load(std::memory_order_acquire) & FRESH))
+			return nullptr;
+
+		front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+
+		const State& state = slots[front];
+
+		for (int32 id = 0; id < nTotalParams; ++id)
+		{
+			if (state.written[id])
+				recorded[id] = state.normalised[id];
+		}
+
+		return &state;
+	}
+
+	// Audio thread, after a block. Records the values the block changed.
+	inline void record(const double* normalised)
+	{
+		for (int32 id = 0; id < nTotalParams; ++id)
+		{
+			if (recorded[id] != normalised[id])
+			{
+				recorded[id] = normalised[id];
+				latest[id].store(normalised[id], std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// While process isn't running. Records all the values in use.
+	void store(const double* normalised)
+	{
+		for (int32 id = 0; id < nTotalParams; ++id)
+		{
+			recorded[id] = normalised[id];
+			latest[id].store(normalised[id], std::memory_order_relaxed);
+		}
+	}
+
+	double latestValue(ParamID id) const
+	{
+		return latest[id].load(std::memory_order_relaxed);
+	}
+
+private:
+	static constexpr int INDEX = 3;
+	static constexpr int FRESH = 4;
+
+	State slots[3];
+
+	// Triple buffer: the audio thread owns front, the writer owns back and pending.
+	alignas(64) std::atomic<int> middle = 1;
+	alignas(64) int front = 0;
+	alignas(64) int back = 2;
+
+	State pending;
+
+	// The audio thread's values as it last recorded them.
+	alignas(64) double recorded[nTotalParams] = { 0.0 };
+
+	alignas(64) std::atomic<double> latest[nTotalParams] = {};
+};
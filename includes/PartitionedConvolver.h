@@ -0,0 +1,186 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+
+#include "FFT.h"
+
+// Uniformly partitioned overlap-save convolution of two channels with one real kernel.
+//
+// The kernel is cut into partitions of the block size B, each transformed at 2B. Every B samples
+// the last 2B of input are transformed once, into a ring of past spectra, and the output block is
+// the inverse of the sum of each past spectrum times its partition. The output lags the input by
+// B samples. The channels are the real and imaginary parts of one complex signal, see FFT.
+//
+// Only the newest partition waits for the end of a block of B. The older ones multiply spectra
+// already known, their share of the next output is accumulated as the block's samples come in, so
+// the work per sample is flat and a host block pays at most one FFT pair and one partition more.
+class PartitionedConvolver {
+public:
+	// Allocates, for kernels of up to kernelSize taps.
+	void prepare(int blockSize, int kernelSize)
+	{
+		B = blockSize;
+		P = (kernelSize + B - 1) / B;
+		fft.prepare(2 * B);
+
+		kernelRe.assign(size_t(P) * 2 * B, 0.0);
+		kernelIm.assign(size_t(P) * 2 * B, 0.0);
+		spectrumRe.assign(size_t(P) * 2 * B, 0.0);
+		spectrumIm.assign(size_t(P) * 2 * B, 0.0);
+		timeRe.assign(2 * B, 0.0);
+		timeIm.assign(2 * B, 0.0);
+		sumRe.assign(2 * B, 0.0);
+		sumIm.assign(2 * B, 0.0);
+		nextRe.assign(2 * B, 0.0);
+		nextIm.assign(2 * B, 0.0);
+
+		reset();
+	}
+
+	void reset()
+	{
+		std::fill(spectrumRe.begin(), spectrumRe.end(), 0.0);
+		std::fill(spectrumIm.begin(), spectrumIm.end(), 0.0);
+		std::fill(timeRe.begin(), timeRe.end(), 0.0);
+		std::fill(timeIm.begin(), timeIm.end(), 0.0);
+		std::fill(sumRe.begin(), sumRe.end(), 0.0);
+		std::fill(sumIm.begin(), sumIm.end(), 0.0);
+		std::fill(nextRe.begin(), nextRe.end(), 0.0);
+		std::fill(nextIm.begin(), nextIm.end(), 0.0);
+
+		newest = 0;
+		fill = 0;
+		accumulated = 0;
+	}
+
+	// Replaces the kernel, taps beyond size are zero. Takes effect from the next block of B.
+	void setKernel(const double* kernel, int size)
+	{
+		// The inverse transform's 1 / 2B is folded in.
+		const double scale = 1.0 / double(2 * B);
+
+		for (int p = 0; p < P; ++p)
+		{
+			double* re = kernelRe.data() + size_t(p) * 2 * B;
+			double* im = kernelIm.data() + size_t(p) * 2 * B;
+
+			const int from = (std::min)(p * B, size);
+			const int to = (std::min)(from + B, size);
+
+			std::fill(re, re + 2 * B, 0.0);
+			std::fill(im, im + 2 * B, 0.0);
+
+			for (int t = from; t < to; ++t)
+				re[t - from] = kernel[t] * scale;
+
+			fft.forward(re, im);
+		}
+	}
+
+	int latency() const
+	{
+		return B;
+	}
+
+	void process(const double* inL, const double* inR, double* outL, double* outR, int samples)
+	{
+		for (int done = 0; done < samples;)
+		{
+			const int count = (std::min)(samples - done, B - fill);
+
+			// The second half collects the current block, the first holds the previous one.
+			std::copy(inL + done, inL + done + count, timeRe.data() + B + fill);
+			std::copy(inR + done, inR + done + count, timeIm.data() + B + fill);
+
+			// Output computed at the end of the previous block, the valid half of its inverse.
+			std::copy(sumRe.data() + B + fill, sumRe.data() + B + fill + count, outL + done);
+			std::copy(sumIm.data() + B + fill, sumIm.data() + B + fill + count, outR + done);
+
+			done += count;
+			fill += count;
+
+			// The older partitions in proportion to the samples collected, all of them by the end of the block.
+			accumulate((P - 1) * fill / B);
+
+			if (fill == B)
+			{
+				convolveBlock();
+				fill = 0;
+			}
+		}
+	}
+
+private:
+	// y += spectrum in slot times partition p.
+	void multiplyAdd(int slot, int p, double* yRe, double* yIm)
+	{
+		const int N = 2 * B;
+		const double* aRe = spectrumRe.data() + size_t(slot) * N;
+		const double* aIm = spectrumIm.data() + size_t(slot) * N;
+		const double* hRe = kernelRe.data() + size_t(p) * N;
+		const double* hIm = kernelIm.data() + size_t(p) * N;
+
+		for (int k = 0; k < N; ++k)
+		{
+			yRe[k] += aRe[k] * hRe[k] - aIm[k] * hIm[k];
+			yIm[k] += aRe[k] * hIm[k] + aIm[k] * hRe[k];
+		}
+	}
+
+	// Partitions 1 to partitions of the next output. The ring runs backwards, so partition p will
+	// meet the spectrum p blocks old at newest + p, one slot before the current newest + p.
+	void accumulate(int partitions)
+	{
+		for (; accumulated < partitions; ++accumulated)
+		{
+			const int p = accumulated + 1;
+			multiplyAdd((newest + p - 1) % P, p, nextRe.data(), nextIm.data());
+		}
+	}
+
+	void convolveBlock()
+	{
+		newest = (newest + P - 1) % P;
+
+		double* xRe = spectrumRe.data() + size_t(newest) * 2 * B;
+		double* xIm = spectrumIm.data() + size_t(newest) * 2 * B;
+
+		std::copy(timeRe.begin(), timeRe.end(), xRe);
+		std::copy(timeIm.begin(), timeIm.end(), xIm);
+		fft.forward(xRe, xIm);
+
+		sumRe.swap(nextRe);
+		sumIm.swap(nextIm);
+		multiplyAdd(newest, 0, sumRe.data(), sumIm.data());
+		fft.inverse(sumRe.data(), sumIm.data());
+
+		std::fill(nextRe.begin(), nextRe.end(), 0.0);
+		std::fill(nextIm.begin(), nextIm.end(), 0.0);
+		accumulated = 0;
+
+		std::copy(timeRe.begin() + B, timeRe.end(), timeRe.begin());
+		std::copy(timeIm.begin() + B, timeIm.end(), timeIm.begin());
+	}
+
+	int B = 0,
+		P = 0;
+	FFT fft;
+
+	// Partition p of the kernel and the input spectrum of each of the last P blocks, 2B bins each.
+	std::vector<double> kernelRe,
+		kernelIm,
+		spectrumRe,
+		spectrumIm;
+
+	// Last 2B input samples, the inverse of the last block's sum and the older partitions' share of the next.
+	std::vector<double> timeRe,
+		timeIm,
+		sumRe,
+		sumIm,
+		nextRe,
+		nextIm;
+
+	int newest = 0,
+		fill = 0,
+		accumulated = 0;	// Older partitions in next
+};
@@ -0,0 +1,330 @@
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MappedFile.h"
+#include "parameters.h"
+
+// Preset library in one file, mapped read-only and browsed through a binary index.
+//
+// Layout, little endian:
+//   Header
+//   char tagNames[tagCount][TAG_SIZE]
+//   char parameterTitles[parameterCount][TITLE_SIZE], the parameters the index holds values for
+//   index, presetCount entries of entrySize bytes: an Entry, then float normalised[parameterCount]
+//   states, in the format of Kwire2Processor::getState (title, then the plain value as a double)
+//
+// Browsing only reads the index: names, tags and values are fixed-size fields, so a search is a
+// scan over mapped memory without parsing or allocating. A preset's state is only paged in when it
+// is applied. The bank is built by Kwire2bank.
+class PresetBank {
+public:
+	static constexpr uint32_t VERSION = 1;
+	static constexpr int NAME_SIZE = 48;
+	static constexpr int TAG_SIZE = 24;
+	static constexpr int TITLE_SIZE = 32;
+	static constexpr int MAX_TAGS = 64;	// Bits of Entry::tags
+
+	struct Header {
+		char magic[4];	// "KW2B"
+		uint32_t version,
+			presetCount,
+			tagCount,
+			parameterCount,
+			entrySize;
+		uint64_t indexOffset;
+	};
+
+	struct Entry {
+		char name[NAME_SIZE];
+		uint64_t tags;	// Bit t set for tagNames[t]
+		uint64_t stateOffset;
+		uint32_t stateSize;
+		uint32_t reserved;
+	};
+
+	// A preset for build, state as written by getState.
+	struct Preset {
+		std::string name;
+		std::vector<std::string> tags;
+		std::vector<char> state;
+	};
+
+	PresetBank() = default;
+	PresetBank(const PresetBank&) = delete;
+	PresetBank& operator=(const PresetBank&) = delete;
+
+	bool open(const std::filesystem::path& path)
+	{
+		close();
+
+		if (!file.open(path, MappedFile::Read) || file.size() < sizeof(Header))
+			return close();
+
+		data = file.map(0, size_t(file.size()));
+
+		if (!data)
+			return close();
+
+		std::memcpy(&header, data, sizeof(Header));
+
+		const uint64_t tablesEnd = sizeof(Header) + uint64_t(header.tagCount) * TAG_SIZE + uint64_t(header.parameterCount) * TITLE_SIZE;
+		const uint64_t indexEnd = header.indexOffset + uint64_t(header.presetCount) * header.entrySize;
+
+		if (std::memcmp(header.magic, "KW2B", 4) != 0 || header.version != VERSION || header.tagCount > MAX_TAGS
+			|| header.entrySize % 8 != 0 || header.entrySize < sizeof(Entry) + sizeof(float) * uint64_t(header.parameterCount)
+			|| header.indexOffset % 8 != 0 || header.indexOffset < tablesEnd || indexEnd > file.size())
+			return close();
+
+		// Index column of each parameter, by title so banks survive parameters being added or reordered.
+		const char* titles = reinterpret_cast<const char*>(data + sizeof(Header) + header.tagCount * TAG_SIZE);
+
+		for (CustomParameter& parameter : customParameters)
+		{
+			column[parameter.id] = -1;
+
+			for (uint32_t c = 0; c < header.parameterCount; ++c)
+			{
+				if (field(titles + c * TITLE_SIZE, TITLE_SIZE) == parameter.title)
+					column[parameter.id] = int(c);
+			}
+		}
+
+		return true;
+	}
+
+	// Returns false, for open.
+	bool close()
+	{
+		file.close();
+		data = nullptr;
+		header = {};
+		return false;
+	}
+
+	int size() const
+	{
+		return int(header.presetCount);
+	}
+
+	std::string_view name(int preset) const
+	{
+		return field(entry(preset).name, NAME_SIZE);
+	}
+
+	uint64_t tags(int preset) const
+	{
+		return entry(preset).tags;
+	}
+
+	int tagCount() const
+	{
+		return int(header.tagCount);
+	}
+
+	std::string_view tagName(int tag) const
+	{
+		return field(reinterpret_cast<const char*>(data + sizeof(Header) + tag * TAG_SIZE), TAG_SIZE);
+	}
+
+	// Bit of the tag with the given name, 0 if no preset has it.
+	uint64_t tagMask(std::string_view tag) const
+	{
+		for (int t = 0; t < tagCount(); ++t)
+		{
+			if (tagName(t) == tag)
+				return uint64_t(1) << t;
+		}
+
+		return 0;
+	}
+
+	// Normalised value of a parameter in a preset, its default if the bank doesn't have it.
+	double normalised(int preset, Steinberg::Vst::ParamID id) const
+	{
+		if (column[id] < 0)
+			return customParameters[id].plainToNormalised(customParameters[id].defaultPlain);
+
+		float value;
+		std::memcpy(&value, reinterpret_cast<const uint8_t*>(&entry(preset)) + sizeof(Entry) + column[id] * sizeof(float), sizeof(float));
+		return value;
+	}
+
+	// Calls visit(preset), in bank order, for the presets having every tag in tags and a name
+	// containing text, ignoring case.
+	template <typename Visitor>
+	void find(std::string_view text, uint64_t tags, Visitor&& visit) const
+	{
+		const auto sameLetter = [](char a, char b) {
+			return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+		};
+
+		for (int p = 0; p < size(); ++p)
+		{
+			const Entry& e = entry(p);
+
+			if ((e.tags & tags) != tags)
+				continue;
+
+			const std::string_view presetName = field(e.name, NAME_SIZE);
+
+			if (std::search(presetName.begin(), presetName.end(), text.begin(), text.end(), sameLetter) != presetName.end())
+				visit(p);
+		}
+	}
+
+	// The preset's state, valid while the bank is open.
+	bool state(int preset, const uint8_t*& blob, uint32_t& blobSize) const
+	{
+		const Entry& e = entry(preset);
+
+		if (e.stateOffset < header.indexOffset || e.stateOffset + e.stateSize > file.size())
+			return false;
+
+		blob = data + e.stateOffset;
+		blobSize = e.stateSize;
+		return true;
+	}
+
+	// Normalised values of a state, defaults for the parameters it doesn't have. False if it's malformed.
+	static bool readState(const uint8_t* state, size_t stateSize, double (&normalised)[nTotalParams])
+	{
+		for (CustomParameter& parameter : customParameters)
+			normalised[parameter.id] = parameter.plainToNormalised(parameter.defaultPlain);
+
+		size_t position = 0;
+
+		while (position + sizeof(int32_t) <= stateSize)
+		{
+			int32_t length;
+			std::memcpy(&length, state + position, sizeof(int32_t));
+			position += sizeof(int32_t);
+
+			// The length counts the terminating zero.
+			if (length <= 0 || stateSize - position < size_t(length) + sizeof(double))
+				return false;
+
+			const std::string_view title(reinterpret_cast<const char*>(state + position), size_t(length) - 1);
+			position += size_t(length);
+
+			double plain;
+			std::memcpy(&plain, state + position, sizeof(double));
+			position += sizeof(double);
+
+			for (CustomParameter& parameter : customParameters)
+			{
+				if (parameter.title == title)
+					normalised[parameter.id] = parameter.plainToNormalised(plain);
+			}
+		}
+
+		return position == stateSize;
+	}
+
+	// The bank file for presets, empty if they have more than MAX_TAGS different tags. Presets whose
+	// state is malformed are left out, their indices in rejected.
+	static std::vector<char> build(const std::vector<Preset>& presets, std::vector<size_t>& rejected)
+	{
+		std::vector<const Preset*> kept;
+		std::vector<float> values;
+
+		rejected.clear();
+
+		for (size_t p = 0; p < presets.size(); ++p)
+		{
+			double normalised[nTotalParams];
+
+			if (!readState(reinterpret_cast<const uint8_t*>(presets[p].state.data()), presets[p].state.size(), normalised))
+			{
+				rejected.push_back(p);
+				continue;
+			}
+
+			kept.push_back(&presets[p]);
+			values.insert(values.end(), normalised, normalised + nTotalParams);
+		}
+
+		std::vector<std::string> tagNames;
+
+		for (const Preset* preset : kept)
+			tagNames.insert(tagNames.end(), preset->tags.begin(), preset->tags.end());
+
+		std::sort(tagNames.begin(), tagNames.end());
+		tagNames.erase(std::unique(tagNames.begin(), tagNames.end()), tagNames.end());
+
+		if (tagNames.size() > MAX_TAGS)
+			return {};
+
+		Header bankHeader = {};
+		std::memcpy(bankHeader.magic, "KW2B", sizeof(bankHeader.magic));
+		bankHeader.version = VERSION;
+		bankHeader.presetCount = uint32_t(kept.size());
+		bankHeader.tagCount = uint32_t(tagNames.size());
+		bankHeader.parameterCount = uint32_t(nTotalParams);
+		bankHeader.entrySize = uint32_t(align8(sizeof(Entry) + sizeof(float) * nTotalParams));
+		bankHeader.indexOffset = align8(sizeof(Header) + tagNames.size() * TAG_SIZE + nTotalParams * TITLE_SIZE);
+
+		std::vector<char> bank(bankHeader.indexOffset + kept.size() * bankHeader.entrySize, 0);
+		std::memcpy(bank.data(), &bankHeader, sizeof(Header));
+
+		char* tagTable = bank.data() + sizeof(Header);
+
+		for (size_t t = 0; t < tagNames.size(); ++t)
+			tagNames[t].copy(tagTable + t * TAG_SIZE, TAG_SIZE - 1);
+
+		char* titles = tagTable + tagNames.size() * TAG_SIZE;
+
+		for (CustomParameter& parameter : customParameters)
+			parameter.title.copy(titles + parameter.id * TITLE_SIZE, TITLE_SIZE - 1);
+
+		for (size_t p = 0; p < kept.size(); ++p)
+		{
+			const Preset& preset = *kept[p];
+
+			Entry e = {};
+			preset.name.copy(e.name, NAME_SIZE - 1);
+
+			for (const std::string& tag : preset.tags)
+				e.tags |= uint64_t(1) << (std::lower_bound(tagNames.begin(), tagNames.end(), tag) - tagNames.begin());
+
+			e.stateOffset = bank.size();
+			e.stateSize = uint32_t(preset.state.size());
+
+			char* slot = bank.data() + bankHeader.indexOffset + p * bankHeader.entrySize;
+			std::memcpy(slot, &e, sizeof(Entry));
+			std::memcpy(slot + sizeof(Entry), values.data() + p * nTotalParams, sizeof(float) * nTotalParams);
+
+			bank.insert(bank.end(), preset.state.begin(), preset.state.end());
+		}
+
+		return bank;
+	}
+
+private:
+	static uint64_t align8(uint64_t size)
+	{
+		return (size + 7) & ~uint64_t(7);
+	}
+
+	// Fixed-size text field, zero terminated unless it fills the field.
+	static std::string_view field(const char* text, size_t fieldSize)
+	{
+		return std::string_view(text, strnlen(text, fieldSize));
+	}
+
+	const Entry& entry(int preset) const
+	{
+		return *reinterpret_cast<const Entry*>(data + header.indexOffset + uint64_t(preset) * header.entrySize);
+	}
+
+	MappedFile file;
+	const uint8_t* data = nullptr;
+	Header header = {};
+	int column[nTotalParams];
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Real-time safety audit. With KWIRE2_RT_AUDIT defined, process() marks the audio thread while it runs
+// and the hooks in RealtimeAudit.cpp report allocations, frees, locks and blocking calls made inside it.
+// Without it the scope compiles to nothing.
+
+namespace RealtimeAudit {
+#ifdef KWIRE2_RT_AUDIT
+	static constexpr bool enabled = true;
+#else
+	static constexpr bool enabled = false;
+#endif
+
+	// Called with a short description of the offending call. The default handler prints it.
+	using Handler = void (*)(const char* what);
+
+	inline thread_local int callbackDepth = 0;
+	inline std::atomic<uint64_t> violationCount = 0;
+	inline std::atomic<Handler> handler = nullptr;
+
+	inline bool inAudioCallback()
+	{
+		return callbackDepth > 0;
+	}
+
+	// Defined in RealtimeAudit.cpp, only built in audit builds.
+	void violation(const char* what);
+
+	inline void check(const char* what)
+	{
+		if constexpr (enabled)
+		{
+			if (inAudioCallback())
+				violation(what);
+		}
+	}
+
+	inline uint64_t violations()
+	{
+		return violationCount.load(std::memory_order_relaxed);
+	}
+
+	// Marks the calling thread as inside the audio callback.
+	struct Scope {
+		Scope() { if constexpr (enabled) ++callbackDepth; }
+		~Scope() { if constexpr (enabled) --callbackDepth; }
+	};
+}
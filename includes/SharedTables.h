@@ -0,0 +1,95 @@
+#pragma once
+#include <mutex>
+
+#include "constants.h"
+#include "LookupTable.h"
+
+// Read-only tables shared by every instance in the process, so a few hundred instances
+// keep one copy in the last level cache instead of one each.
+//
+// The tables are built by the first acquire, which never happens on the audio thread,
+// and freed when the last reference is released. The factory holds a reference for the
+// lifetime of the module (Kwire2entry.cpp), so instances coming and going don't rebuild
+// them, and every processor holds one of its own.
+//
+// cheapTanh and the parameter skew (funLog) stay computed: each is one division, cheaper
+// than a table read and exact.
+class SharedTables {
+public:
+	// Decibels to gain from -48 to +48 dB at 64 points per dB, within 1e-6 of dbtoa.
+	static constexpr double MIN_DB = -48.0;
+	static constexpr double MAX_DB = 48.0;
+	static constexpr int POINTS_PER_DB = 64;
+	static constexpr size_t DECIBEL_TABLE_SIZE = size_t((MAX_DB - MIN_DB) * POINTS_PER_DB) + 1;
+
+	using DecibelTable = LookupTable<double, DECIBEL_TABLE_SIZE>;
+
+	// tan(pi * f), the bilinear prewarp of the TPT filters, for normalised frequencies f up
+	// to 0.49. The table holds 256 steps; the rest of the angle goes through the tangent
+	// addition formula, so the result is within 2 ulp of tan at half its cost.
+	static constexpr double MAX_WARP_FREQUENCY = 0.49;
+	static constexpr size_t WARP_TABLE_SIZE = 257;
+	static constexpr double WARP_STEP = M_PI * MAX_WARP_FREQUENCY / double(WARP_TABLE_SIZE - 1);
+
+	using WarpTable = LookupTable<double, WARP_TABLE_SIZE>;
+
+	static const SharedTables* acquire()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (references++ == 0)
+			instance = new SharedTables();
+
+		return instance;
+	}
+
+	static void release()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		assert(references > 0);
+
+		if (--references == 0)
+		{
+			delete instance;
+			instance = nullptr;
+		}
+	}
+
+	inline double dbtoa(const double dB) const
+	{
+		return decibelToGain.lookup(std::clamp((dB - MIN_DB) * (1.0 / (MAX_DB - MIN_DB)), 0.0, 1.0));
+	}
+
+	// Frequency over sample rate, clamped to the table's range.
+	inline double prewarp(const double normalisedFrequency) const
+	{
+		const double angle = M_PI * std::clamp(normalisedFrequency, 0.0, MAX_WARP_FREQUENCY);
+		const size_t i = size_t(angle * (1.0 / WARP_STEP) + 0.5);
+
+		// Taylor series of the remainder, at most half a step.
+		const double b = angle - double(i) * WARP_STEP;
+		const double b2 = b * b;
+		const double tanB = b * (1.0 + b2 * (1.0 / 3.0 + b2 * (2.0 / 15.0 + b2 * (17.0 / 315.0))));
+		const double tanA = warp.table[i];
+
+		return (tanA + tanB) / (1.0 - tanA * tanB);
+	}
+
+private:
+	SharedTables()
+	{
+		for (size_t i = 0; i < DECIBEL_TABLE_SIZE; ++i)
+			decibelToGain.table[i] = ::dbtoa(MIN_DB + double(i) / double(POINTS_PER_DB));
+
+		for (size_t i = 0; i < WARP_TABLE_SIZE; ++i)
+			warp.table[i] = tan(double(i) * WARP_STEP);
+	}
+
+	DecibelTable decibelToGain;
+	WarpTable warp;
+
+	static inline std::mutex mutex;
+	static inline SharedTables* instance = nullptr;
+	static inline int references = 0;
+};
@@ -0,0 +1,244 @@
+#pragma once
+#define _USE_MATH_DEFINES
+#include <algorithm>
+#include <math.h>
+
+#include "SharedTables.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define KWIRE2_SIDECHAIN_EQ_SSE2
+#endif
+
+// Sidechain EQ, up to BANDS bands in series shaping what the detector hears.
+//
+// Every band is the TPTSVF topology with its highpass, bandpass and lowpass mixed into the band's
+// response, y = m0 * input + m1 * bandpass + m2 * lowpass, with Simper's coefficients for the
+// shelves and the bell. The bank is stored transposed: one row per band, each coefficient and state
+// held for both channels side by side, so with SSE2 a sample of both channels goes through all the
+// active bands in registers.
+//
+// setBand only recomputes a band's coefficients when one of its settings changed.
+class SidechainEQ {
+public:
+	static constexpr int BANDS = 4;
+
+	// Values of the band type parameters.
+	enum Type {
+		Off,
+		LowShelf,
+		Bell,
+		HighShelf,
+		Highpass,
+		Lowpass,
+		NumTypes
+	};
+
+	explicit SidechainEQ(const SharedTables& sharedTables) :
+		tables(sharedTables)
+	{
+	}
+
+	void setSampleRate(double samplerate)
+	{
+		sampleRate = samplerate;
+
+		for (int b = 0; b < BANDS; ++b)
+			updateCoefficients(b);
+
+		reset();
+	}
+
+	void reset()
+	{
+		for (Band& band : bands)
+		{
+			std::fill(band.s1, band.s1 + 2, 0.0);
+			std::fill(band.s2, band.s2 + 2, 0.0);
+		}
+	}
+
+	void setBand(int b, Type type, double frequency, double gainDb, double q)
+	{
+		Settings& current = settings[b];
+
+		if (type == current.type && frequency == current.frequency && gainDb == current.gainDb && q == current.q)
+			return;
+
+		// A band coming back starts from silence rather than from where it was left.
+		if (current.type == Off && type != Off)
+		{
+			std::fill(bands[b].s1, bands[b].s1 + 2, 0.0);
+			std::fill(bands[b].s2, bands[b].s2 + 2, 0.0);
+		}
+
+		current = { type, frequency, gainDb, q };
+		updateCoefficients(b);
+
+		activeCount = 0;
+
+		for (int band = 0; band < BANDS; ++band)
+		{
+			if (settings[band].type != Off)
+				active[activeCount++] = band;
+		}
+	}
+
+	inline bool isActive() const
+	{
+		return activeCount > 0;
+	}
+
+	// Both channels in place, through the active bands in order.
+	void process(double* left, double* right, int samples)
+	{
+#ifdef KWIRE2_SIDECHAIN_EQ_SSE2
+		for (int s = 0; s < samples; ++s)
+		{
+			__m128d x = _mm_set_pd(right[s], left[s]);
+
+			for (int i = 0; i < activeCount; ++i)
+			{
+				Band& band = bands[active[i]];
+
+				const __m128d g = _mm_load_pd(band.g);
+				const __m128d s1 = _mm_load_pd(band.s1);
+				const __m128d s2 = _mm_load_pd(band.s2);
+
+				const __m128d highpass = _mm_mul_pd(_mm_load_pd(band.h),
+					_mm_sub_pd(_mm_sub_pd(x, _mm_mul_pd(s1, _mm_load_pd(band.feedback))), s2));
+
+				const __m128d bandpass = _mm_add_pd(_mm_mul_pd(highpass, g), s1);
+				_mm_store_pd(band.s1, _mm_add_pd(_mm_mul_pd(highpass, g), bandpass));
+
+				const __m128d lowpass = _mm_add_pd(_mm_mul_pd(bandpass, g), s2);
+				_mm_store_pd(band.s2, _mm_add_pd(_mm_mul_pd(bandpass, g), lowpass));
+
+				x = _mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_load_pd(band.m0), x), _mm_mul_pd(_mm_load_pd(band.m1), bandpass)),
+					_mm_mul_pd(_mm_load_pd(band.m2), lowpass));
+			}
+
+			_mm_storel_pd(left + s, x);
+			_mm_storeh_pd(right + s, x);
+		}
+#else
+		for (int s = 0; s < samples; ++s)
+		{
+			double x[2] = { left[s], right[s] };
+
+			for (int i = 0; i < activeCount; ++i)
+			{
+				Band& band = bands[active[i]];
+
+				for (int c = 0; c < 2; ++c)
+				{
+					const double highpass = band.h[c] * (x[c] - band.s1[c] * band.feedback[c] - band.s2[c]);
+
+					const double bandpass = highpass * band.g[c] + band.s1[c];
+					band.s1[c] = highpass * band.g[c] + bandpass;
+
+					const double lowpass = bandpass * band.g[c] + band.s2[c];
+					band.s2[c] = bandpass * band.g[c] + lowpass;
+
+					x[c] = band.m0[c] * x[c] + band.m1[c] * bandpass + band.m2[c] * lowpass;
+				}
+			}
+
+			left[s] = x[0];
+			right[s] = x[1];
+		}
+#endif
+	}
+
+	// Not finite if a band's state isn't.
+	inline double stateSum() const
+	{
+		double sum = 0.0;
+
+		for (const Band& band : bands)
+			sum += band.s1[0] + band.s1[1] + band.s2[0] + band.s2[1];
+
+		return sum;
+	}
+
+private:
+	struct Settings {
+		Type type = Off;
+		double frequency = 0.0,
+			gainDb = 0.0,
+			q = 0.0;
+	};
+
+	// Coefficients and state of a band, lane 0 for the left channel and 1 for the right.
+	struct alignas(16) Band {
+		double g[2],
+			feedback[2],
+			h[2],
+			m0[2],
+			m1[2],
+			m2[2],
+			s1[2],
+			s2[2];
+	};
+
+	void updateCoefficients(int b)
+	{
+		const Settings& band = settings[b];
+
+		if (band.type == Off)
+			return;
+
+		const double A = pow(10.0, band.gainDb / 40.0);
+		const double q = (std::max)(band.q, 0.01);
+		double g = tables.prewarp(std::clamp(band.frequency, 5.0, 0.49 * sampleRate) / sampleRate);
+		double R2 = 1.0 / q;
+		double m0 = 1.0,
+			m1 = 0.0,
+			m2 = 0.0;
+
+		switch (band.type)
+		{
+		case LowShelf:
+			g /= sqrt(A);
+			m1 = R2 * (A - 1.0);
+			m2 = A * A - 1.0;
+			break;
+		case Bell:
+			R2 = 1.0 / (q * A);
+			m1 = R2 * (A * A - 1.0);
+			break;
+		case HighShelf:
+			g *= sqrt(A);
+			m0 = A * A;
+			m1 = R2 * (1.0 - A) * A;
+			m2 = 1.0 - A * A;
+			break;
+		case Highpass:
+			m1 = -R2;
+			m2 = -1.0;
+			break;
+		case Lowpass:
+			m0 = 0.0;
+			m2 = 1.0;
+			break;
+		default:
+			break;
+		}
+
+		const double coefficients[] = { g, g + R2, 1.0 / (1.0 + R2 * g + g * g), m0, m1, m2 };
+		double* rows[] = { bands[b].g, bands[b].feedback, bands[b].h, bands[b].m0, bands[b].m1, bands[b].m2 };
+
+		for (int row = 0; row < 6; ++row)
+			std::fill(rows[row], rows[row] + 2, coefficients[row]);
+	}
+
+	const SharedTables& tables;
+	double sampleRate = 44100.0;
+
+	Band bands[BANDS] = {};
+	Settings settings[BANDS];
+
+	// Bands not Off, in order.
+	int active[BANDS] = {};
+	int activeCount = 0;
+};
@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define KWIRE2_SIGNAL_GUARD_SSE
+#endif
+
+// Containment of NaN and Inf in the processor.
+//
+// The input is scanned every block, one vectorised pass per channel, and only a block that fails is
+// repaired. The recursions are checked through the sum of their state, which isn't finite if any of
+// it isn't, and cleared when it fails; without this one bad sample would stay in the filter and
+// envelope states until the plug-in is reloaded. The output of every processed block is scanned too:
+// finite input and states can still overflow it, eg. a sample near the float limit through input gain,
+// and the host must never receive NaN or Inf.
+namespace SignalGuard {
+	// Blocks repaired or recovered, for diagnostics.
+	struct Counters {
+		std::atomic<uint32_t> inputs { 0 },
+			outputs { 0 },
+			states { 0 };
+	};
+
+	// Every sample finite. x * 0 is 0 when x is and NaN otherwise, summed in independent lanes so
+	// the loop vectorises without reassociating.
+	template <typename T>
+	inline bool isFinite(const T* x, int samples)
+	{
+		constexpr int LANES = 32 / sizeof(T);
+
+		T sum[LANES] = {};
+		int s = 0;
+
+		for (; s + LANES <= samples; s += LANES)
+		{
+			for (int l = 0; l < LANES; ++l)
+				sum[l] += x[s + l] * T(0);
+		}
+
+		for (; s < samples; ++s)
+			sum[0] += x[s] * T(0);
+
+		T total = 0;
+
+		for (T lane : sum)
+			total += lane;
+
+		return total == T(0);
+	}
+
+	// Silences the samples that aren't finite.
+	template <typename T>
+	inline void repair(const T* x, T* y, int samples)
+	{
+		for (int s = 0; s < samples; ++s)
+			y[s] = std::isfinite(x[s]) ? x[s] : T(0);
+	}
+
+	inline void count(std::atomic<uint32_t>& counter)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	// Denormals flushed to zero for the scope, so decaying recursions don't fall onto the slow path.
+	class DenormalScope {
+	public:
+#ifdef KWIRE2_SIGNAL_GUARD_SSE
+		DenormalScope() :
+			mode(_mm_getcsr())
+		{
+			_mm_setcsr(mode | FLUSH_TO_ZERO | DENORMALS_ARE_ZERO);
+		}
+
+		~DenormalScope()
+		{
+			_mm_setcsr(mode);
+		}
+
+	private:
+		static constexpr unsigned int FLUSH_TO_ZERO = 0x8000;
+		static constexpr unsigned int DENORMALS_ARE_ZERO = 0x0040;
+
+		const unsigned int mode;
+#endif
+	};
+}
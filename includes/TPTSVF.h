@@ -1,5 +1,6 @@
 #pragma once
 #include <TPTFilter.h>
+#include "SharedTables.h"
 
 // The Art of VA Filter Design p. 110
 class TPTSVF : public TPTFilter 
@@ -36,6 +37,17 @@ public:
 
 		return (this->*out[mode])();
 	}
+
+	// Filters a block, with the output selection hoisted out of the sample loop.
+	inline void process(const double* input, double* output, int numSamples)
+	{
+		switch (mode)
+		{
+		case Lowpass: processBlock<Lowpass>(input, output, numSamples); break;
+		case Bandpass: processBlock<Bandpass>(input, output, numSamples); break;
+		default: processBlock<Highpass>(input, output, numSamples); break;
+		}
+	}
 	
 	inline double lowpass() override { return i2y; }
 	inline double bandpass() { return i1y; }
@@ -45,6 +57,12 @@ public:
 		i1x = i1s = i1y = i2s = i2y = 0;
 	}
 
+	// Not finite if either integrator isn't.
+	inline double stateSum() const
+	{
+		return i1s + i2s;
+	}
+
 	inline void setCutoff(double cutoffFrequency) override 
 	{
 		cutoff = std::clamp(cutoffFrequency, 5.0, 20000.0);
@@ -54,6 +72,16 @@ public:
 		updateCoefficients();
 	}
 
+	// Same, with the prewarp read from the shared table.
+	inline void setCutoff(double cutoffFrequency, const SharedTables& tables)
+	{
+		cutoff = std::clamp(cutoffFrequency, 5.0, 20000.0);
+
+		g = tables.prewarp(cutoff * inverseSampleRate);
+
+		updateCoefficients();
+	}
+
 	double resonance = 0.1;
 
 	/// Set cutoff frequency and resonance.
@@ -71,6 +99,33 @@ public:
 	}
 
 protected:
+	// State is kept in locals, the output could otherwise alias it and force a store every sample.
+	template <int outputMode>
+	inline void processBlock(const double* input, double* output, int numSamples)
+	{
+		double x = i1x, s1 = i1s, y1 = i1y, s2 = i2s, y2 = i2y;
+		const double feedbackGain = g + R2;
+
+		for (int s = 0; s < numSamples; ++s)
+		{
+			x = h * (input[s] - (s1 * feedbackGain + s2));
+
+			y1 = x * g + s1;
+			s1 = x * g + y1;
+
+			y2 = y1 * g + s2;
+			s2 = y1 * g + y2;
+
+			output[s] = outputMode == Lowpass ? y2 : outputMode == Bandpass ? y1 : x;
+		}
+
+		i1x = x;
+		i1s = s1;
+		i1y = y1;
+		i2s = s2;
+		i2y = y2;
+	}
+
 	typedef double (TPTSVF::* Output)();
 	Output out[NumModes];
 
@@ -14,6 +14,16 @@
 static constexpr int MAX_BUFFER_SIZE = 4096;
 static constexpr int DISPLAY_VALUE_COUNT = 16;
 
+// Alignment of the audio buffers. Set KWIRE2_BUFFER_ALIGNMENT to compare layouts (8 is the natural alignment of double).
+#ifndef KWIRE2_BUFFER_ALIGNMENT
+#define KWIRE2_BUFFER_ALIGNMENT 64
+#endif
+
+static constexpr size_t BUFFER_ALIGNMENT = KWIRE2_BUFFER_ALIGNMENT;
+
+// Glide time (ms) for parameter changes.
+static constexpr double PARAM_SMOOTHING_TIME = 20.0;
+
 //=========================================
 // Functions
 
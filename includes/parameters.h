@@ -27,13 +27,180 @@ enum ParameterIDs {
 	clipThresholdId,
 	mixId,
 	outGainId,
+	kneeId,
+	bypassId,
+	qualityId,
 	nParams
 };
 
+// Values of qualityId.
+enum Quality {
+	Eco,
+	Normal,
+	High
+};
+
+// Parameters behind the modulation layer (includes/Modulation.h), after the user parameters
+// so existing ids don't move. The CC parameters are hidden, hosts map MIDI CCs to them.
 enum InternalParameterIDs {
-	nTotalParams = nParams
+	modWheelId = nParams,
+	expressionId,
+	lfoRateId,
+	followerReleaseId,
+	mod1SourceId,
+	mod1DestinationId,
+	mod1AmountId,
+	mod2SourceId,
+	mod2DestinationId,
+	mod2AmountId,
+	mod3SourceId,
+	mod3DestinationId,
+	mod3AmountId,
+	mod4SourceId,
+	mod4DestinationId,
+	mod4AmountId,
+	nInternalEnd
+};
+
+// Side channel detector settings, relative to the mid ones. Added after the internal parameters
+// so no existing id moves.
+enum SideParameterIDs {
+	sideThresholdId = nInternalEnd,
+	sideRatioId,
+	sideAttackId,
+	sideReleaseId,
+	nSideEnd
+};
+
+// Crossover phase and the linear phase mode's partition size. They set the latency, so the processor
+// only takes them up when it's activated, and they aren't automatable.
+enum CrossoverParameterIDs {
+	crossoverPhaseId = nSideEnd,
+	crossoverPartitionId,
+	nCrossoverEnd
+};
+
+// Sidechain EQ bands (includes/SidechainEQ.h), shaping the detector after the crossover.
+enum SidechainEQParameterIDs {
+	eq1TypeId = nCrossoverEnd,
+	eq1FrequencyId,
+	eq1GainId,
+	eq1QId,
+	eq2TypeId,
+	eq2FrequencyId,
+	eq2GainId,
+	eq2QId,
+	eq3TypeId,
+	eq3FrequencyId,
+	eq3GainId,
+	eq3QId,
+	eq4TypeId,
+	eq4FrequencyId,
+	eq4GainId,
+	eq4QId,
+	nEqEnd
+};
+
+// Processing options, not automatable.
+enum OptionParameterIDs {
+	bypassDetectorId = nEqEnd,
+	offlineQualityId,
+	nTotalParams
+};
+
+// Type, frequency, gain and Q of a band follow each other.
+static constexpr int EQ_BAND_PARAMS = eq2TypeId - eq1TypeId;
+
+inline const bool paramIsSidechainEQ(Steinberg::Vst::ParamID id) {
+	return id >= eq1TypeId && id < nEqEnd;
+}
+
+// Values of crossoverPhaseId.
+enum CrossoverPhase {
+	MinimumPhase,
+	LinearPhase
+};
+
+// Values of bypassDetectorId. Running keeps the detector going while fully bypassed, so coming back
+// starts from the current gain reduction rather than the one at the time of bypassing.
+enum BypassDetector {
+	DetectorPaused,
+	DetectorRunning
+};
+
+// Values of offlineQualityId, what offline bounces use.
+enum OfflineQuality {
+	OfflineFollowsQuality,
+	OfflineHigh
 };
 
+// Partition sizes, MIN_PARTITION << crossoverPartitionId.
+static constexpr int MIN_PARTITION = 64;
+
+// Source, destination and amount of a modulation slot follow each other.
+static constexpr int MOD_SLOT_PARAMS = mod2SourceId - mod1SourceId;
+
+// Modulation destinations, in the order of the destination parameters' values.
+static constexpr Steinberg::Vst::ParamID modDestinations[] = {
+	crossoverId, thresholdId, ratioId, attackId, releaseId, clipThresholdId, kneeId
+};
+
+inline const bool paramIsInternal(Steinberg::Vst::ParamID id) {
+	return id >= nParams && id < nInternalEnd;
+}
+
+// Slow moving parameters, evaluated at control rate and linearly interpolated in between.
+// Gains and mixes stay at audio rate to avoid zipper noise.
+inline const bool paramIsControlRate(Steinberg::Vst::ParamID id) {
+	if (paramIsInternal(id) || paramIsSidechainEQ(id))
+		return true;
+
+	switch (id)
+	{
+	case crossoverId:
+	case thresholdId:
+	case ratioId:
+	case attackId:
+	case releaseId:
+	case clipThresholdId:
+	case kneeId:
+	case sideThresholdId:
+	case sideRatioId:
+	case sideAttackId:
+	case sideReleaseId:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Parameters the processor reports a different latency for.
+inline const bool paramChangesLatency(Steinberg::Vst::ParamID id) {
+	return id == crossoverPhaseId || id == crossoverPartitionId;
+}
+
+// Gains set in dB, mapped through dbtoa.
+inline const bool paramIsDecibelGain(Steinberg::Vst::ParamID id) {
+	return id == inGainId || id == outGainId;
+}
+
+#define MOD_SLOT(n) \
+	CustomParameter(mod##n##SourceId, "Mod " #n " Source", "Mod" #n " Src", "", 0, 4, 0, 4, 0, [](double plain) { return plain; }, \
+		Steinberg::Vst::ParameterInfo::ParameterFlags::kCanAutomate | Steinberg::Vst::ParameterInfo::ParameterFlags::kIsList, \
+		{ "Off", "Mod Wheel", "Expression", "LFO", "Follower" }), \
+	CustomParameter(mod##n##DestinationId, "Mod " #n " Destination", "Mod" #n " Dst", "", 0, 6, 1, 6, 0, [](double plain) { return plain; }, \
+		Steinberg::Vst::ParameterInfo::ParameterFlags::kCanAutomate | Steinberg::Vst::ParameterInfo::ParameterFlags::kIsList, \
+		{ "Crossover", "Threshold", "Ratio", "Attack", "Release", "Clip Threshold", "Knee" }), \
+	CustomParameter(mod##n##AmountId, "Mod " #n " Amount", "Mod" #n " Amt", "%", -100, 100, 0, 0, 0, [](double plain) { return plain * 0.01; })
+
+#define EQ_BAND(n, frequency) \
+	CustomParameter(eq##n##TypeId, "EQ " #n " Type", "EQ" #n " Type", "", 0, 5, 0, 5, 0, [](double plain) { return plain; }, \
+		Steinberg::Vst::ParameterInfo::ParameterFlags::kCanAutomate | Steinberg::Vst::ParameterInfo::ParameterFlags::kIsList, \
+		{ "Off", "Low Shelf", "Bell", "High Shelf", "Highpass", "Lowpass" }), \
+	CustomParameter(eq##n##FrequencyId, "EQ " #n " Frequency", "EQ" #n " Freq", "Hz", 20, 20000, frequency, 0, -0.7), \
+	CustomParameter(eq##n##GainId, "EQ " #n " Gain", "EQ" #n " Gain", "dB", -18, 18, 0), \
+	CustomParameter(eq##n##QId, "EQ " #n " Q", "EQ" #n " Q", "", 0.1, 10, 0.71, 0, -0.5)
+
 static CustomParameter customParameters[nTotalParams] = {
 	CustomParameter(inGainId, "Input", "Input", "dB", -12, 36, 0, 0, 0, [](double plain) { return dbtoa(plain); }),
 	CustomParameter(crossoverId, "Crossover", "Cross", "Hz", 10, 800, 120, 0.0, -0.5),
@@ -44,9 +211,48 @@ static CustomParameter customParameters[nTotalParams] = {
 	CustomParameter(clipMixId, "Clip Mix", "Clip Mix", "%", 0, 100, 0, 0, 0, [](double plain) { return plain * 0.01; }),
 	CustomParameter(clipThresholdId, "Clip Threshold", "Clip Thrsh", "dB", -12, 0, 0, 0, 0, [](double plain) { return dbtoa(plain); }),
 	CustomParameter(mixId, "Mix", "Mix", "%", 0, 100, 100, 0, 0, [](double plain) { return plain * 0.01; }),
-	CustomParameter(outGainId, "Output", "Out", "dB", -24, 24, 0, 0, 0, [](double plain) { return dbtoa(plain); })
+	CustomParameter(outGainId, "Output", "Out", "dB", -24, 24, 0, 0, 0, [](double plain) { return dbtoa(plain); }),
+	CustomParameter(kneeId, "Knee", "Knee", "dB", 0, 24, 0),
+	CustomParameter(bypassId, "Bypass", "Bypass", "", 0, 1, 0, 1, 0, [](double plain) { return plain; },
+		Steinberg::Vst::ParameterInfo::ParameterFlags::kCanAutomate | Steinberg::Vst::ParameterInfo::ParameterFlags::kIsBypass),
+	CustomParameter(qualityId, "Quality", "Quality", "", 0, 2, Normal, 2, 0, [](double plain) { return plain; },
+		Steinberg::Vst::ParameterInfo::ParameterFlags::kCanAutomate | Steinberg::Vst::ParameterInfo::ParameterFlags::kIsList,
+		{ "Eco", "Normal", "High" }),
+	CustomParameter(modWheelId, "Mod Wheel", "Mod Wheel", "%", 0, 100, 0, 0, 0, [](double plain) { return plain * 0.01; },
+		Steinberg::Vst::ParameterInfo::ParameterFlags::kCanAutomate | Steinberg::Vst::ParameterInfo::ParameterFlags::kIsHidden),
+	CustomParameter(expressionId, "Expression", "Expression", "%", 0, 100, 0, 0, 0, [](double plain) { return plain * 0.01; },
+		Steinberg::Vst::ParameterInfo::ParameterFlags::kCanAutomate | Steinberg::Vst::ParameterInfo::ParameterFlags::kIsHidden),
+	CustomParameter(lfoRateId, "LFO Rate", "LFO Rate", "Hz", 0.01, 20, 1, 0, -0.7),
+	CustomParameter(followerReleaseId, "Follower Release", "Fol Rel", "ms", 10, 2000, 200, 0, -0.6),
+	MOD_SLOT(1),
+	MOD_SLOT(2),
+	MOD_SLOT(3),
+	MOD_SLOT(4),
+	CustomParameter(sideThresholdId, "Side Threshold", "S Thresh", "dB", -12, 12, 0),
+	CustomParameter(sideRatioId, "Side Ratio", "S Ratio", "%", 0, 200, 100, 0, 0, [](double plain) { return plain * 0.01; }),
+	CustomParameter(sideAttackId, "Side Attack", "S Attack", "x", 0.25, 8, 3),
+	CustomParameter(sideReleaseId, "Side Release", "S Release", "x", 0.25, 8, 2),
+	CustomParameter(crossoverPhaseId, "Crossover Phase", "X Phase", "", 0, 1, MinimumPhase, 1, 0, [](double plain) { return plain; },
+		Steinberg::Vst::ParameterInfo::ParameterFlags::kIsList,
+		{ "Minimum", "Linear" }),
+	CustomParameter(crossoverPartitionId, "Crossover Partition", "X Part", "", 0, 5, 2, 5, 0, [](double plain) { return plain; },
+		Steinberg::Vst::ParameterInfo::ParameterFlags::kIsList,
+		{ "64", "128", "256", "512", "1024", "2048" }),
+	EQ_BAND(1, 100),
+	EQ_BAND(2, 500),
+	EQ_BAND(3, 2000),
+	EQ_BAND(4, 8000),
+	CustomParameter(bypassDetectorId, "Bypass Detector", "Byp Det", "", 0, 1, DetectorPaused, 1, 0, [](double plain) { return plain; },
+		Steinberg::Vst::ParameterInfo::ParameterFlags::kIsList,
+		{ "Paused", "Running" }),
+	CustomParameter(offlineQualityId, "Offline Quality", "Offl Q", "", 0, 1, OfflineHigh, 1, 0, [](double plain) { return plain; },
+		Steinberg::Vst::ParameterInfo::ParameterFlags::kIsList,
+		{ "Quality", "High" })
 };
 
+#undef MOD_SLOT
+#undef EQ_BAND
+
 static CustomParameter* parameterWithTitle(const std::string name)
 {
 	if (!name.empty())
@@ -14,5 +14,12 @@ static const Steinberg::FUID kKwire2ControllerUID (0xC799788A, 0xF6B65D28, 0x894
 
 #define Kwire2VST3Category "Fx"
 
+// Controller to processor message carrying a whole state, attribute "state" in the getState format.
+static const Steinberg::FIDString kPresetStateMessage = "PresetState";
+
+// Controller to processor message carrying a parameter that changes the latency, attributes "id" and
+// "value" (normalised). Sent before asking the host to restart, so the processor has the value then.
+static const Steinberg::FIDString kLatencyParameterMessage = "LatencyParameter";
+
 //------------------------------------------------------------------------
 } // namespace Kwire2
@@ -1,9 +1,13 @@
-#include <sstream>
 #include "base/source/fstreamer.h"
+#include "public.sdk/source/common/memorystream.h"
+#include "pluginterfaces/base/smartpointer.h"
 #include "vstgui/plugin-bindings/vst3editor.h"
 #include "Kwire2controller.h"
 #include "Kwire2cids.h"
+#include "Kwire2historyview.h"
+#include "Kwire2loadview.h"
 #include "parameters.h"
+#include "ParameterFormat.h"
 
 using namespace Steinberg;
 using namespace Steinberg::Vst;
@@ -25,7 +29,7 @@ tresult PLUGIN_API Kwire2Controller::initialize (FUnknown* context)
 	}
 
 	// Here you could register some parameters
-	for (int i = 0; i < nParams; ++i)
+	for (int i = 0; i < nTotalParams; ++i)
 	{
 		CustomParameter& param = customParameters[i];
 
@@ -43,6 +47,10 @@ tresult PLUGIN_API Kwire2Controller::initialize (FUnknown* context)
 		parameters.addParameter(p);
 	}
 
+	// Installed presets, if any.
+	if (const char* appData = std::getenv("APPDATA"))
+		loadPresetBank(std::filesystem::path(appData) / "Laser Brain" / "Kwire2" / "Presets.kw2bank");
+
 	return result;
 }
 
@@ -101,7 +109,7 @@ tresult PLUGIN_API Kwire2Controller::getState (IBStream* state)
 {
 	IBStreamer streamer(state, kLittleEndian);
 
-	for (ParamID id = 0; id < nParams; ++id)
+	for (ParamID id = 0; id < nTotalParams; ++id)
 	{
 		CustomParameter& param = customParameters[id];
 		
@@ -114,6 +122,56 @@ tresult PLUGIN_API Kwire2Controller::getState (IBStream* state)
 	return kResultOk;
 }
 
+//------------------------------------------------------------------------
+bool Kwire2Controller::loadPresetBank(const std::filesystem::path& path)
+{
+	return bank.open(path);
+}
+
+//------------------------------------------------------------------------
+// Loading a preset through setParamNormalized and performEdit sends the host an edit per parameter
+// and has the processor pick up every one of them as a separate change. Here the controller's values
+// change without telling the host, the processor gets the whole state in one message, and the host
+// rereads every value once.
+bool Kwire2Controller::applyPreset(int preset)
+{
+	const uint8_t* state;
+	uint32_t stateSize;
+	double normalised[nTotalParams];
+
+	if (preset < 0 || preset >= bank.size() || !bank.state(preset, state, stateSize)
+		|| !PresetBank::readState(state, stateSize, normalised))
+		return false;
+
+	int32 flags = kParamValuesChanged;
+
+	// The views follow through the parameters' dependents.
+	for (ParamID id = 0; id < nTotalParams; ++id)
+	{
+		if (paramChangesLatency(id) && normalised[id] != parameters.getParameter(id)->getNormalized())
+			flags |= kLatencyChanged;
+
+		parameters.getParameter(id)->setNormalized(normalised[id]);
+	}
+
+	// Written back rather than forwarded, so parameters the preset doesn't have go to their defaults
+	// in the processor too.
+	MemoryStream stream;
+	getState(&stream);
+
+	if (IPtr<IMessage> message = owned(allocateMessage()))
+	{
+		message->setMessageID(kPresetStateMessage);
+		message->getAttributes()->setBinary("state", stream.getData(), uint32(stream.getSize()));
+		sendMessage(message);
+	}
+
+	if (componentHandler)
+		componentHandler->restartComponent(flags);
+
+	return true;
+}
+
 //------------------------------------------------------------------------
 IPlugView* PLUGIN_API Kwire2Controller::createView (FIDString name)
 {
@@ -131,7 +189,26 @@ IPlugView* PLUGIN_API Kwire2Controller::createView (FIDString name)
 tresult PLUGIN_API Kwire2Controller::setParamNormalized(Vst::ParamID tag, Vst::ParamValue value)
 {
 	// called by host to update your parameters
-	return EditControllerEx1::setParamNormalized(tag, value);;
+	const bool latencyChanged = paramChangesLatency(tag) && value != getParamNormalized(tag);
+	const tresult result = EditControllerEx1::setParamNormalized(tag, value);
+
+	// The host reactivates the processor, which takes up the new crossover then. The value only
+	// reaches process after the restart, so the processor gets it first.
+	if (latencyChanged && result == kResultOk)
+	{
+		if (IPtr<IMessage> message = owned(allocateMessage()))
+		{
+			message->setMessageID(kLatencyParameterMessage);
+			message->getAttributes()->setInt("id", int64(tag));
+			message->getAttributes()->setFloat("value", value);
+			sendMessage(message);
+		}
+
+		if (componentHandler)
+			componentHandler->restartComponent(kLatencyChanged);
+	}
+
+	return result;
 }
 
 Steinberg::Vst::ParamValue Kwire2Controller::getParamNormalized(Steinberg::Vst::ParamID tag)
@@ -142,14 +219,15 @@ Steinberg::Vst::ParamValue Kwire2Controller::getParamNormalized(Steinberg::Vst::
 //------------------------------------------------------------------------
 tresult PLUGIN_API Kwire2Controller::getParamStringByValue(Vst::ParamID tag, Vst::ParamValue valueNormalized, Vst::String128 string)
 {
-	if (tag >= 0 || tag < nParams)
+	if (tag < nTotalParams)
 	{
 		CustomParameter& param = customParameters[tag];
-		std::stringstream display;
-		display << std::fixed << std::setprecision(param.stepCount == 0 ? 2 : 0) << param.normalisedToPlain(valueNormalized) << " " << param.units;
+		char display[ParameterFormat::BUFFER_SIZE];
 
-		bool convert = Steinberg::Vst::StringConvert::convert(display.str(), string);
-		return convert ? kResultTrue : kResultFalse;
+		const int length = ParameterFormat::format(param, param.normalisedToPlain(valueNormalized), display, sizeof(display));
+		ParameterFormat::widen(display, length, string);
+
+		return length > 0 ? kResultTrue : kResultFalse;
 	}
 
 	return kResultFalse;
@@ -160,15 +238,16 @@ tresult PLUGIN_API Kwire2Controller::getParamValueByString(Vst::ParamID tag, Vst
 {
 	// called by host to get a normalized value from a string representation of a specific parameter
 	// (without having to set the value!)
-	if (tag >= 0 || tag < nParams)
+	if (tag < nTotalParams)
 	{
 		CustomParameter& param = customParameters[tag];
-		std::string str;
-		bool convert = Steinberg::Vst::StringConvert::convert(str, string);
+		char text[ParameterFormat::BUFFER_SIZE];
+		int length;
+		double plain;
 
-		if (convert)
+		if (ParameterFormat::narrow(string, text, sizeof(text), length) && ParameterFormat::parse(param, text, length, plain))
 		{
-			valueNormalized = param.plainToNormalised(std::stod(str));
+			valueNormalized = param.plainToNormalised(plain);
 
 			return kResultTrue;
 		}
@@ -177,6 +256,75 @@ tresult PLUGIN_API Kwire2Controller::getParamValueByString(Vst::ParamID tag, Vst
 	return EditControllerEx1::getParamValueByString(tag, string, valueNormalized);
 }
 
+//------------------------------------------------------------------------
+tresult PLUGIN_API Kwire2Controller::getMidiControllerAssignment(int32 busIndex, int16 channel, CtrlNumber midiControllerNumber, ParamID& id)
+{
+	// The CCs drive hidden parameters, which the modulation slots use as sources. Any channel.
+	if (busIndex != 0)
+		return kResultFalse;
+
+	switch (midiControllerNumber)
+	{
+	case kCtrlModWheel:
+		id = modWheelId;
+		return kResultTrue;
+	case kCtrlExpression:
+		id = expressionId;
+		return kResultTrue;
+	default:
+		return kResultFalse;
+	}
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API Kwire2Controller::notify(Vst::IMessage* message)
+{
+	if (dataExchange.onMessage(message))
+		return kResultTrue;
+
+	return EditControllerEx1::notify(message);
+}
+
+//------------------------------------------------------------------------
+void PLUGIN_API Kwire2Controller::queueOpened(Vst::DataExchangeUserContextID userContextID, uint32 blockSize, TBool& dispatchOnBackgroundThread)
+{
+	// The history is only touched on the UI thread, like the views drawing it.
+	dispatchOnBackgroundThread = false;
+}
+
+void PLUGIN_API Kwire2Controller::queueClosed(Vst::DataExchangeUserContextID userContextID)
+{
+}
+
+void PLUGIN_API Kwire2Controller::onDataExchangeBlocksReceived(Vst::DataExchangeUserContextID userContextID, uint32 numBlocks, Vst::DataExchangeBlock* blocks, TBool onBackgroundThread)
+{
+	for (uint32 i = 0; i < numBlocks; ++i)
+	{
+		if (blocks[i].size < sizeof(GainReductionHistory::Block))
+			continue;
+
+		const auto* block = static_cast<const GainReductionHistory::Block*>(blocks[i].data);
+		history.setSampleRate(block->sampleRate);
+		load = { block->load, block->loadPeak };
+
+		for (uint32 f = 0; f < (std::min)(block->numFrames, uint32(GainReductionHistory::Block::MAX_FRAMES)); ++f)
+			history.push(block->frames[f]);
+	}
+}
+
+//------------------------------------------------------------------------
+VSTGUI::CView* Kwire2Controller::createCustomView(VSTGUI::UTF8StringPtr name, const VSTGUI::UIAttributes& attributes, const VSTGUI::IUIDescription* description, VSTGUI::VST3Editor* editor)
+{
+	// Placed and sized by the uidesc.
+	if (name && strcmp(name, "GainReductionHistory") == 0)
+		return new GainReductionHistoryView(VSTGUI::CRect(0, 0, 0, 0), history);
+
+	if (name && strcmp(name, "DspLoad") == 0)
+		return new DspLoadView(VSTGUI::CRect(0, 0, 0, 0), load);
+
+	return nullptr;
+}
+
 Steinberg::Vst::ParamValue Kwire2Controller::normalizedParamToPlain(Steinberg::Vst::ParamID tag, Steinberg::Vst::ParamValue valueNormalized)
 {
 	return EditControllerEx1::normalizedParamToPlain(tag, valueNormalized);
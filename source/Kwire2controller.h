@@ -4,10 +4,16 @@
 
 #pragma once
 
+#include "pluginterfaces/vst/ivstmidicontrollers.h"
 #include "public.sdk/source/vst/vsteditcontroller.h"
+#include "public.sdk/source/vst/utility/dataexchange.h"
 #include "public.sdk/source/vst/utility/stringconvert.h"
+#include "vstgui/plugin-bindings/vst3editor.h"
 
 #include "CustomParameter.h"
+#include "GainReductionHistory.h"
+#include "LoadMeter.h"
+#include "PresetBank.h"
 #include "parameters.h"
 
 using namespace Steinberg;
@@ -18,7 +24,7 @@ namespace Kwire2 {
 //------------------------------------------------------------------------
 //  Kwire2Controller
 //------------------------------------------------------------------------
-class Kwire2Controller : public Steinberg::Vst::EditControllerEx1
+class Kwire2Controller : public Steinberg::Vst::EditControllerEx1, public Steinberg::Vst::IMidiMapping, public Steinberg::Vst::IDataExchangeReceiver, public VSTGUI::VST3EditorDelegate
 {
 public:
 //------------------------------------------------------------------------
@@ -47,10 +53,36 @@ public:
 	Steinberg::Vst::ParamValue PLUGIN_API normalizedParamToPlain(Steinberg::Vst::ParamID tag, Steinberg::Vst::ParamValue valueNormalized) SMTG_OVERRIDE;
 	Steinberg::Vst::ParamValue PLUGIN_API plainParamToNormalized(Steinberg::Vst::ParamID tag, Steinberg::Vst::ParamValue plainValue) SMTG_OVERRIDE;
 
+	//--- from IMidiMapping ----------------------------------------------
+	Steinberg::tresult PLUGIN_API getMidiControllerAssignment(Steinberg::int32 busIndex, Steinberg::int16 channel, Steinberg::Vst::CtrlNumber midiControllerNumber, Steinberg::Vst::ParamID& id) SMTG_OVERRIDE;
+
+	//--- from ComponentBase ---------------------------------------------
+	Steinberg::tresult PLUGIN_API notify(Steinberg::Vst::IMessage* message) SMTG_OVERRIDE;
+
+	//--- from IDataExchangeReceiver -------------------------------------
+	void PLUGIN_API queueOpened(Steinberg::Vst::DataExchangeUserContextID userContextID, Steinberg::uint32 blockSize, Steinberg::TBool& dispatchOnBackgroundThread) SMTG_OVERRIDE;
+	void PLUGIN_API queueClosed(Steinberg::Vst::DataExchangeUserContextID userContextID) SMTG_OVERRIDE;
+	void PLUGIN_API onDataExchangeBlocksReceived(Steinberg::Vst::DataExchangeUserContextID userContextID, Steinberg::uint32 numBlocks, Steinberg::Vst::DataExchangeBlock* blocks, Steinberg::TBool onBackgroundThread) SMTG_OVERRIDE;
+
+	//--- from VST3EditorDelegate ----------------------------------------
+	VSTGUI::CView* createCustomView(VSTGUI::UTF8StringPtr name, const VSTGUI::UIAttributes& attributes, const VSTGUI::IUIDescription* description, VSTGUI::VST3Editor* editor) SMTG_OVERRIDE;
+
+	//--- Preset bank ----------------------------------------------------
+	// Maps a bank built by Kwire2bank in place of the open one.
+	bool loadPresetBank(const std::filesystem::path& path);
+	const PresetBank& presetBank() const { return bank; }
+
+	// Sets every parameter to the preset in one change, see the definition.
+	bool applyPreset(int preset);
+
+	// Processor load, as of the last history block.
+	LoadMeter::Reading dspLoad() const { return load; }
+
  	//---Interface---------
 	DEFINE_INTERFACES
 		// Here you can add more supported VST3 interfaces
-		// DEF_INTERFACE (Vst::IXXX)
+		DEF_INTERFACE (Vst::IMidiMapping)
+		DEF_INTERFACE (Vst::IDataExchangeReceiver)
 	END_DEFINE_INTERFACES (EditController)
     DELEGATE_REFCOUNT (EditController)
 
@@ -58,7 +90,7 @@ public:
 protected:
 	CustomParameter* parameterWithTitle(const std::string name)
 	{
-		for (ParamID id = 0; id < nParams; ++id)
+		for (ParamID id = 0; id < nTotalParams; ++id)
 		{
 			if (customParameters[id].title == name)
 				return &customParameters[id];
@@ -66,6 +98,14 @@ protected:
 
 		return nullptr;
 	}
+
+	// Gain reduction history from the processor, drawn by the editor's history views.
+	GainReductionHistory::Pyramid history;
+	LoadMeter::Reading load;
+	Steinberg::Vst::DataExchangeReceiverHandler dataExchange { this };
+
+	// Mapped for the controller's lifetime, browsing never copies it.
+	PresetBank bank;
 };
 
 //------------------------------------------------------------------------
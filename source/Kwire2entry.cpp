@@ -8,12 +8,18 @@
 #include "version.h"
 
 #include "public.sdk/source/main/pluginfactory.h"
+#include "public.sdk/source/main/moduleinit.h"
 
 #define stringPluginName "K-wire 2"
 
 using namespace Steinberg::Vst;
 using namespace Kwire2;
 
+//------------------------------------------------------------------------
+// The module keeps the shared tables alive between instances, built when the host loads it.
+static Steinberg::ModuleInitializer acquireSharedTables([]() { SharedTables::acquire(); });
+static Steinberg::ModuleTerminator releaseSharedTables([]() { SharedTables::release(); });
+
 //------------------------------------------------------------------------
 //  VST Plug-in Entry
 //------------------------------------------------------------------------
@@ -0,0 +1,271 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2025 Laser Brain.
+//------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "Kwire2historyview.h"
+
+using namespace VSTGUI;
+using namespace GainReductionHistory;
+
+namespace Kwire2 {
+
+namespace {
+	// Vertical ranges in dB.
+	constexpr double REDUCTION_RANGE = 24.0;
+	constexpr double LEVEL_RANGE = 60.0;
+
+	constexpr double MIN_SECONDS = 1.0;
+	constexpr double MAX_SECONDS = 40.0;
+
+	const CColor backgroundColor(24, 24, 28);
+	const CColor levelColor(70, 110, 150);
+	const CColor levelBandColor(45, 65, 90);
+	const CColor reductionColor(230, 90, 60);
+	const CColor reductionBandColor(120, 55, 45);
+	const CColor sweepColor(90, 90, 100);
+
+	// One timer refreshes every history view in the process, however many editors are open.
+	std::vector<GainReductionHistoryView*>& views()
+	{
+		static std::vector<GainReductionHistoryView*> list;
+		return list;
+	}
+
+	SharedPointer<CVSTGUITimer>& timer()
+	{
+		static SharedPointer<CVSTGUITimer> shared;
+		return shared;
+	}
+
+	void addView(GainReductionHistoryView* view)
+	{
+		views().push_back(view);
+
+		if (!timer())
+		{
+			timer() = makeOwned<CVSTGUITimer>([](CVSTGUITimer*) {
+				for (GainReductionHistoryView* each : views())
+					each->refresh();
+			}, 1000 / GainReductionHistoryView::REFRESH_RATE, true);
+		}
+	}
+
+	void removeView(GainReductionHistoryView* view)
+	{
+		views().erase(std::remove(views().begin(), views().end(), view), views().end());
+
+		if (views().empty() && timer())
+		{
+			timer()->stop();
+			timer() = nullptr;
+		}
+	}
+}
+
+//------------------------------------------------------------------------
+GainReductionHistoryView::GainReductionHistoryView(const CRect& size, const Pyramid& history) :
+	CView(size),
+	history(history)
+{
+}
+
+GainReductionHistoryView::~GainReductionHistoryView()
+{
+	removeView(this);
+}
+
+//------------------------------------------------------------------------
+bool GainReductionHistoryView::attached(CView* parent)
+{
+	if (!CView::attached(parent))
+		return false;
+
+	offscreen = COffscreenContext::create(getViewSize().getSize(), getFrame() ? getFrame()->getScaleFactor() : 1.0);
+	redrawAll();
+
+	addView(this);
+	return true;
+}
+
+bool GainReductionHistoryView::removed(CView* parent)
+{
+	removeView(this);
+	offscreen = nullptr;
+
+	return CView::removed(parent);
+}
+
+void GainReductionHistoryView::setViewSize(const CRect& rect, bool invalid)
+{
+	CView::setViewSize(rect, invalid);
+
+	if (isAttached())
+	{
+		offscreen = COffscreenContext::create(getViewSize().getSize(), getFrame() ? getFrame()->getScaleFactor() : 1.0);
+		redrawAll();
+	}
+}
+
+void GainReductionHistoryView::onMouseWheelEvent(MouseWheelEvent& event)
+{
+	if (event.deltaY == 0.0)
+		return;
+
+	// Wheel up zooms in.
+	visibleSeconds = std::clamp(visibleSeconds * std::pow(0.9, event.deltaY), MIN_SECONDS, MAX_SECONDS);
+	redrawAll();
+
+	event.consumed = true;
+}
+
+//------------------------------------------------------------------------
+double GainReductionHistoryView::framesPerColumn() const
+{
+	const double sr = history.sampleRate > 0.0 ? history.sampleRate : 48000.0;
+	const double width = (std::max)(1.0, getViewSize().getWidth());
+
+	return (std::max)(1.0, visibleSeconds * sr / (double(FRAME_SAMPLES) * width));
+}
+
+void GainReductionHistoryView::refresh()
+{
+	if (!offscreen)
+		return;
+
+	if (history.generation != generation || history.sampleRate != sampleRate)
+	{
+		redrawAll();
+		return;
+	}
+
+	const int width = int(getViewSize().getWidth());
+	const double step = framesPerColumn();
+	const double available = double(history.size());
+
+	if (width <= 0 || nextFrame + step > available)
+		return;
+
+	// After a stall only the newest columns are visible.
+	nextFrame = (std::max)(nextFrame, available - step * double(width));
+
+	const int firstColumn = writeColumn;
+	int columns = 0;
+
+	offscreen->beginDraw();
+
+	for (; nextFrame + step <= available; nextFrame += step, ++columns)
+	{
+		drawColumn(offscreen, writeColumn, history.range(int64_t(std::floor(nextFrame)), int64_t(std::floor(nextFrame + step))));
+		writeColumn = (writeColumn + 1) % width;
+	}
+
+	offscreen->endDraw();
+
+	// The new columns, and the sweep line that moved past them.
+	invalidColumns(firstColumn, columns + 1);
+}
+
+void GainReductionHistoryView::invalidColumns(int first, int count)
+{
+	const CRect& rect = getViewSize();
+	const int width = int(rect.getWidth());
+
+	if (count >= width)
+	{
+		invalid();
+		return;
+	}
+
+	const int end = first + count;
+
+	invalidRect(CRect(rect.left + first, rect.top, rect.left + (std::min)(end, width), rect.bottom));
+
+	if (end > width)
+		invalidRect(CRect(rect.left, rect.top, rect.left + (end - width), rect.bottom));
+}
+
+void GainReductionHistoryView::redrawAll()
+{
+	generation = history.generation;
+	sampleRate = history.sampleRate;
+
+	const int width = int(getViewSize().getWidth());
+
+	if (!offscreen || width <= 0)
+		return;
+
+	const double step = framesPerColumn();
+
+	// Newest column at the right edge and the sweep line at the left, columns before the history
+	// starts are blank.
+	writeColumn = 0;
+	nextFrame = double(history.size()) - step * double(width);
+
+	offscreen->beginDraw();
+
+	for (int column = 0; column < width; ++column, nextFrame += step)
+		drawColumn(offscreen, column, history.range(int64_t(std::floor(nextFrame)), int64_t(std::floor(nextFrame + step))));
+
+	offscreen->endDraw();
+	invalid();
+}
+
+void GainReductionHistoryView::drawColumn(CDrawContext* context, int column, const Frame& frame)
+{
+	const CCoord height = getViewSize().getHeight();
+	const CCoord x = column;
+
+	context->setFillColor(backgroundColor);
+	context->drawRect(CRect(x, 0, x + 1, height), kDrawFilled);
+
+	if (frame.isEmpty())
+		return;
+
+	// Level from the bottom, lighter between the quietest and the loudest peak (see PEAK_SAMPLES).
+	const auto levelY = [&](float dB) { return height * std::clamp(-double(dB) / LEVEL_RANGE, 0.0, 1.0); };
+
+	context->setFillColor(levelBandColor);
+	context->drawRect(CRect(x, levelY(frame.levelMax), x + 1, height), kDrawFilled);
+	context->setFillColor(levelColor);
+	context->drawRect(CRect(x, levelY(frame.levelMin), x + 1, height), kDrawFilled);
+
+	// Gain reduction from the top, lighter between the least and the most reduction.
+	const auto reductionY = [&](float dB) { return height * std::clamp(double(dB) / REDUCTION_RANGE, 0.0, 1.0); };
+
+	context->setFillColor(reductionBandColor);
+	context->drawRect(CRect(x, 0, x + 1, reductionY(frame.reductionMax)), kDrawFilled);
+	context->setFillColor(reductionColor);
+	context->drawRect(CRect(x, 0, x + 1, reductionY(frame.reductionMin)), kDrawFilled);
+}
+
+//------------------------------------------------------------------------
+void GainReductionHistoryView::draw(CDrawContext* context)
+{
+	const CRect& rect = getViewSize();
+	CBitmap* bitmap = offscreen ? offscreen->getBitmap() : nullptr;
+
+	if (!bitmap)
+	{
+		context->setFillColor(backgroundColor);
+		context->drawRect(rect, kDrawFilled);
+		setDirty(false);
+		return;
+	}
+
+	// Columns stay where they were drawn. The next one to be written, the oldest, is the sweep line.
+	const CCoord width = CCoord(int(rect.getWidth()));
+
+	context->drawBitmap(bitmap, CRect(rect.left, rect.top, rect.left + width, rect.bottom), CPoint(0, 0));
+
+	context->setFillColor(sweepColor);
+	context->drawRect(CRect(rect.left + writeColumn, rect.top, rect.left + writeColumn + 1, rect.bottom), kDrawFilled);
+
+	setDirty(false);
+}
+
+//------------------------------------------------------------------------
+} // namespace Kwire2
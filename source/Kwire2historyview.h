@@ -0,0 +1,69 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2025 Laser Brain.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include "vstgui/vstgui.h"
+
+#include "GainReductionHistory.h"
+
+namespace Kwire2 {
+
+//------------------------------------------------------------------------
+//  GainReductionHistoryView
+//------------------------------------------------------------------------
+// Gain reduction (from the top) and level (from the bottom) of the last seconds, swept from left
+// to right like a scope.
+//
+// Columns are drawn once, when their frames arrive, into an offscreen bitmap used as a ring and
+// shown as it is: a refresh draws and invalidates only the new columns and the sweep line.
+// Zooming with the mouse wheel or resizing redraws every column from the controller's pyramid.
+// Every view in the process is refreshed from one shared timer at REFRESH_RATE, and a view
+// without new frames isn't invalidated at all.
+class GainReductionHistoryView : public VSTGUI::CView
+{
+public:
+	static constexpr int REFRESH_RATE = 30;
+
+	GainReductionHistoryView(const VSTGUI::CRect& size, const GainReductionHistory::Pyramid& history);
+	~GainReductionHistoryView() override;
+
+	void draw(VSTGUI::CDrawContext* context) override;
+	void setViewSize(const VSTGUI::CRect& rect, bool invalid = true) override;
+	void onMouseWheelEvent(VSTGUI::MouseWheelEvent& event) override;
+
+	bool attached(VSTGUI::CView* parent) override;
+	bool removed(VSTGUI::CView* parent) override;
+
+	// Draws the columns completed since the last refresh.
+	void refresh();
+
+private:
+	// Frames per column at the current zoom and width.
+	double framesPerColumn() const;
+
+	void redrawAll();
+
+	// Invalidates count columns from first, wrapping around the right edge.
+	void invalidColumns(int first, int count);
+
+	void drawColumn(VSTGUI::CDrawContext* context, int column, const GainReductionHistory::Frame& frame);
+
+	const GainReductionHistory::Pyramid& history;
+
+	VSTGUI::SharedPointer<VSTGUI::COffscreenContext> offscreen;
+
+	// Seconds across the view.
+	double visibleSeconds = 8.0;
+
+	// Next column to draw in the bitmap, and the frame its range starts at.
+	int writeColumn = 0;
+	double nextFrame = 0.0;
+
+	uint32_t generation = 0;
+	double sampleRate = 0.0;
+};
+
+//------------------------------------------------------------------------
+} // namespace Kwire2
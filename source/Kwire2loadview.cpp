@@ -0,0 +1,65 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2025 Laser Brain.
+//------------------------------------------------------------------------
+
+#include <cstdio>
+
+#include "Kwire2loadview.h"
+
+using namespace VSTGUI;
+
+namespace Kwire2 {
+
+//------------------------------------------------------------------------
+DspLoadView::DspLoadView(const CRect& size, const LoadMeter::Reading& reading) :
+	CTextLabel(size),
+	reading(reading)
+{
+	// Placed over the corner of the history view, so only the text is drawn.
+	setFont(kNormalFontSmall);
+	setFontColor(kWhiteCColor);
+	setBackColor(kTransparentCColor);
+	setTransparency(true);
+	setStyle(kNoFrame);
+	setHoriAlign(kRightText);
+}
+
+//------------------------------------------------------------------------
+bool DspLoadView::attached(CView* parent)
+{
+	if (!CTextLabel::attached(parent))
+		return false;
+
+	refresh();
+	timer = makeOwned<CVSTGUITimer>([this](CVSTGUITimer*) { refresh(); }, 1000 / REFRESH_RATE, true);
+
+	return true;
+}
+
+bool DspLoadView::removed(CView* parent)
+{
+	if (timer)
+	{
+		timer->stop();
+		timer = nullptr;
+	}
+
+	return CTextLabel::removed(parent);
+}
+
+//------------------------------------------------------------------------
+void DspLoadView::refresh()
+{
+	char text[32];
+	snprintf(text, sizeof(text), "DSP %.1f%% / %.1f%%", 100.0 * reading.average, 100.0 * reading.peak);
+
+	if (shown == text)
+		return;
+
+	shown = text;
+	setText(text);
+	invalid();
+}
+
+//------------------------------------------------------------------------
+} // namespace Kwire2
@@ -0,0 +1,40 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2025 Laser Brain.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include <string>
+
+#include "vstgui/vstgui.h"
+
+#include "LoadMeter.h"
+
+namespace Kwire2 {
+
+//------------------------------------------------------------------------
+//  DspLoadView
+//------------------------------------------------------------------------
+// The instance's processor load, "DSP 3.1% / 8.4%" for the average and the decaying peak, from the
+// controller's last reading. Refreshed at REFRESH_RATE and only redrawn when the text changes.
+class DspLoadView : public VSTGUI::CTextLabel
+{
+public:
+	static constexpr int REFRESH_RATE = 4;
+
+	DspLoadView(const VSTGUI::CRect& size, const LoadMeter::Reading& reading);
+
+	bool attached(VSTGUI::CView* parent) override;
+	bool removed(VSTGUI::CView* parent) override;
+
+private:
+	void refresh();
+
+	const LoadMeter::Reading& reading;
+
+	VSTGUI::SharedPointer<VSTGUI::CVSTGUITimer> timer;
+	std::string shown;
+};
+
+//------------------------------------------------------------------------
+} // namespace Kwire2
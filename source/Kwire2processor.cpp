@@ -2,12 +2,14 @@
 #include <windows.h>
 #include <algorithm>
 #include <execution>
+#include <numeric>
 
 #include "Kwire2processor.h"
 #include "Kwire2cids.h"
 
 #include "base/source/fstreamer.h"
 #include "pluginterfaces/vst/ivstparameterchanges.h"
+#include "public.sdk/source/common/memorystream.h"
 #include "public.sdk/source/vst/vstaudioprocessoralgo.h"
 
 using namespace Steinberg;
@@ -22,6 +24,9 @@ namespace Kwire2 {
 
 		std::fill(rectifiedSignal, rectifiedSignal + MAX_BUFFER_SIZE, 0);
 		std::fill(sideEnvelope, sideEnvelope + MAX_BUFFER_SIZE, 0);
+		std::fill(ecoMix, ecoMix + MAX_BUFFER_SIZE, 0);
+		std::fill(highMix, highMix + MAX_BUFFER_SIZE, 0);
+		std::fill(upsampledInput, upsampledInput + 2 * MAX_BUFFER_SIZE, 0);
 
 		for (int c = 0; c < 2; ++c)
 		{
@@ -33,13 +38,17 @@ namespace Kwire2 {
 			filter[c].setResonance(0);
 		}
 
-		for (int32 id = 0; id < nParams; ++id)
+		for (int32 id = 0; id < nTotalParams; ++id)
 			setParameterNormalised(id, customParameters[id].plainToNormalised(customParameters[id].defaultPlain));
+
+		snapParameters();
+		parameterSnapshot.store(normalisedValue);
 	}
 
 	//------------------------------------------------------------------------
 	Kwire2Processor::~Kwire2Processor()
 	{
+		SharedTables::release();
 	}
 
 	void Kwire2Processor::setSampleRate(double sr)
@@ -52,18 +61,347 @@ namespace Kwire2 {
 			distortion[c].setSampleRate(sampleRate);
 		}
 
-		updateThreshold = round(updateRate * sampleRate);
+		sidechainEQ.setSampleRate(sampleRate);
+
+		for (int32 id = 0; id < nTotalParams; ++id)
+			smoother[id].setSampleRate(sampleRate);
+
+		modulation.setSampleRate(sampleRate);
+
+		updateThreshold = controlInterval(quality, sampleRate);
+		decimation = detectorDecimation(sampleRate);
+	}
+
+	// Clears every recursion. The block buffers are written before they're read.
+	void Kwire2Processor::reset()
+	{
+		for (int c = 0; c < 2; ++c)
+		{
+			filter[c].reset();
+			distortion[c].reset();
+			peakUpsampler[c].reset();
+			dryRoundTrip[c].reset();
+		}
+
+		sidechainEQ.reset();
+		envelopes.reset();
+		modulation.reset();
+
+		// Only prepared in linear phase.
+		if (linearPhase)
+		{
+			linearCrossover.reset();
+
+			for (int c = 0; c < 2; ++c)
+			{
+				wetDelay[c].reset();
+				dryDelay[c].reset();
+			}
+		}
+
+		rampFrom[DualEnvelope::Mid] = rampTo[DualEnvelope::Mid] = 1.0;
+		rampFrom[DualEnvelope::Side] = rampTo[DualEnvelope::Side] = 1.0;
+		controlPhase = 0;
+
+		wasDecimated = false;
+		groupPhase = 0;
+		groupPeak = 0.0;
+	}
+
+	void Kwire2Processor::recover()
+	{
+		reset();
+	}
+
+	int Kwire2Processor::requestedPartition() const
+	{
+		const auto latest = [&](ParamID id) {
+			return int(lround(customParameters[id].normalisedToReal(parameterSnapshot.latestValue(id))));
+		};
+
+		return latest(crossoverPhaseId) == LinearPhase ? MIN_PARTITION << latest(crossoverPartitionId) : 0;
+	}
+
+	void Kwire2Processor::prepareCrossover()
+	{
+		const int partition = requestedPartition();
+		linearPhase = partition > 0;
+
+		if (!linearPhase)
+			return;
+
+		linearCrossover.prepare(sampleRate, partition);
+
+		for (int c = 0; c < 2; ++c)
+		{
+			wetDelay[c].prepare(linearCrossover.latency());
+			dryDelay[c].prepare(linearCrossover.latency());
+		}
+	}
+
+	template<typename SampleType>
+	void** Kwire2Processor::guardInput(void** in, const int samples)
+	{
+		if (SignalGuard::isFinite(static_cast<const SampleType*>(in[0]), samples)
+			&& SignalGuard::isFinite(static_cast<const SampleType*>(in[1]), samples))
+			return in;
+
+		// The host's buffers are left alone, they may feed other plug-ins.
+		SignalGuard::count(guardCounters.inputs);
+
+		for (int c = 0; c < 2; ++c)
+			SignalGuard::repair(static_cast<const SampleType*>(in[c]), static_cast<SampleType*>(guardedInput[c]), samples);
+
+		return guardedInput;
+	}
+
+	template<typename SampleType>
+	void Kwire2Processor::guardOutput(void** out, const int samples)
+	{
+		if (SignalGuard::isFinite(static_cast<const SampleType*>(out[0]), samples)
+			&& SignalGuard::isFinite(static_cast<const SampleType*>(out[1]), samples))
+			return;
+
+		SignalGuard::count(guardCounters.outputs);
+
+		for (int c = 0; c < 2; ++c)
+			SignalGuard::repair(static_cast<const SampleType*>(out[c]), static_cast<SampleType*>(out[c]), samples);
+	}
+
+	bool Kwire2Processor::guardState()
+	{
+		double sum = envelopes.stateSum() + sidechainEQ.stateSum() + groupPeak
+			+ rampFrom[DualEnvelope::Mid] + rampFrom[DualEnvelope::Side] + rampTo[DualEnvelope::Mid] + rampTo[DualEnvelope::Side];
+
+		for (int c = 0; c < 2; ++c)
+			sum += filter[c].stateSum() + distortion[c].stateSum() + peakUpsampler[c].stateSum() + dryRoundTrip[c].stateSum();
+
+		if (std::isfinite(sum))
+			return true;
+
+		SignalGuard::count(guardCounters.states);
+		recover();
+
+		return false;
+	}
+
+	int Kwire2Processor::controlInterval(Quality tier, double sr)
+	{
+		return std::clamp(int(round(updateRate[tier] * sr)), 1, MAX_BUFFER_SIZE);
+	}
+
+	int Kwire2Processor::controlAlignment(double sr)
+	{
+		const int controlPoints = std::lcm(std::lcm(controlInterval(Eco, sr), controlInterval(Normal, sr)), controlInterval(High, sr));
+		return std::lcm(controlPoints, detectorDecimation(sr));
+	}
+
+	int Kwire2Processor::detectorDecimation(double sr)
+	{
+		constexpr int MAX_DECIMATION = 8;
+		int factor = 1;
+
+		while (factor < MAX_DECIMATION && sr / (2 * factor) >= 44100.0)
+			factor *= 2;
+
+		return factor;
+	}
+
+	bool Kwire2Processor::offlineUsesHigh() const
+	{
+		return processSetup.processMode == Vst::kOffline && lround(realValue[offlineQualityId]) == OfflineHigh;
+	}
+
+	Quality Kwire2Processor::effectiveQuality() const
+	{
+		if (offlineUsesHigh())
+			return High;
+
+		return Quality(std::clamp(int(lround(realValue[qualityId])), int(Eco), int(High)));
+	}
+
+	void Kwire2Processor::updateQualityMix(int samples)
+	{
+		// Below Normal crossfades towards Eco, above towards High.
+		const bool forcedHigh = offlineUsesHigh();
+
+		ecoActive = highActive = false;
+		fullyEco = fullyHigh = true;
+
+		for (int s = 0; s < samples; ++s)
+		{
+			const double q = forcedHigh ? double(High) : paramValue[qualityId][s];
+
+			ecoMix[s] = std::clamp(double(Normal) - q, 0.0, 1.0);
+			highMix[s] = std::clamp(q - double(Normal), 0.0, 1.0);
+
+			ecoActive |= ecoMix[s] > 0.0;
+			highActive |= highMix[s] > 0.0;
+			fullyEco &= ecoMix[s] == 1.0;
+			fullyHigh &= highMix[s] == 1.0;
+		}
 	}
 
 	void Kwire2Processor::setParameterNormalised(ParamID id, double value)
 	{
 		assert(value >= 0.0 && value <= 1.0);
-		assert(id >= 0 && id < nParams);
+		assert(id >= 0 && id < nTotalParams);
 
 		normalisedValue[id] = value;
 		realValue[id] = customParameters[id].normalisedToReal(value);
 	}
 
+	bool Kwire2Processor::takeSnapshot()
+	{
+		const ParameterSnapshot::State* state = parameterSnapshot.read();
+
+		if (!state)
+			return false;
+
+		for (int32 id = 0; id < nTotalParams; ++id)
+		{
+			if (state->written[id])
+			{
+				normalisedValue[id] = state->normalised[id];
+				realValue[id] = state->real[id];
+			}
+		}
+
+		return true;
+	}
+
+	void Kwire2Processor::publishSnapshot(ParameterSnapshot::State& snapshot)
+	{
+		for (int32 id = 0; id < nTotalParams; ++id)
+			snapshot.real[id] = customParameters[id].normalisedToReal(snapshot.normalised[id]);
+
+		parameterSnapshot.publish();
+	}
+
+	void Kwire2Processor::setLatencyParameter(ParamID id, double value)
+	{
+		// Through the snapshot like setState, so neither getLatencySamples nor the next
+		// setActive has to wait for a block to see it. Only this id is written: a state the
+		// controller loaded just before, not yet taken up, keeps its other values.
+		std::lock_guard<std::mutex> lock(stateMutex);
+		ParameterSnapshot::State& snapshot = parameterSnapshot.beginWrite();
+
+		snapshot.set(id, value);
+		publishSnapshot(snapshot);
+	}
+
+	void Kwire2Processor::snapParameters()
+	{
+		for (int32 id = 0; id < nTotalParams; ++id)
+		{
+			smoother[id].reset(normalisedValue[id]);
+			controlPrevious[id] = controlCurrent[id] = realValue[id];
+			paramIsConstant[id] = false;
+		}
+
+		modulation.reset();
+	}
+
+	void Kwire2Processor::updateParameter(ParamID id, ParamPointQueue* points, int samples)
+	{
+		// Picks up values set outside of process (eg. setState).
+		if (smoother[id].target != normalisedValue[id])
+			smoother[id].setTarget(normalisedValue[id]);
+
+		// Settled parameters keep the constant buffer from the previous blocks.
+		if (!points && smoother[id].isSettled() && controlPrevious[id] == controlCurrent[id] && !modulation.modulates(id))
+		{
+			if (!paramIsConstant[id])
+			{
+				std::fill(paramValue[id], paramValue[id] + MAX_BUFFER_SIZE, realValue[id]);
+				paramIsConstant[id] = true;
+			}
+
+			return;
+		}
+
+		paramIsConstant[id] = false;
+		int position = 0;
+
+		// Automation is already a ramp, continuous parameters follow it from point to point: the
+		// value at a point's offset is the point's, so their segments end on it. Toggles and lists
+		// are smoothed from each point.
+		if (points)
+		{
+			const bool followPoints = customParameters[id].stepCount == 0;
+
+			for (const auto& [offset, value] : *points)
+			{
+				const int end = std::clamp(int(offset) + (followPoints ? 1 : 0), position, samples);
+
+				if (followPoints)
+					smoother[id].rampTo(value, end - position);
+
+				renderParameter(id, position, end);
+				position = end;
+
+				if (!followPoints)
+					smoother[id].setTarget(value);
+
+				setParameterNormalised(id, value);
+			}
+		}
+
+		renderParameter(id, position, samples);
+	}
+
+	void Kwire2Processor::renderParameter(ParamID id, int from, int to)
+	{
+		CustomParameter& parameter = customParameters[id];
+
+		// Gains ramp through the shared decibel table rather than an exp per sample.
+		if (paramIsDecibelGain(id))
+		{
+			for (int s = from; s < to; ++s)
+				paramValue[id][s] = sharedTables->dbtoa(parameter.normalisedToPlain(smoother[id].next()));
+
+			return;
+		}
+
+		if (!paramIsControlRate(id))
+		{
+			for (int s = from; s < to; ++s)
+				paramValue[id][s] = parameter.normalisedToReal(smoother[id].next());
+
+			return;
+		}
+
+		// Control points every updateThreshold samples, counted across blocks.
+		// Each control period ramps from the previous control point to the current one.
+		const double scale = 1.0 / double(updateThreshold);
+		const bool modulated = modulation.modulates(id);
+		int consumed = from;
+
+		for (int s = from; s < to;)
+		{
+			const int phase = (controlPhase + s) % updateThreshold;
+
+			if (phase == 0)
+			{
+				smoother[id].skip(s + 1 - consumed);
+				consumed = s + 1;
+
+				controlPrevious[id] = controlCurrent[id];
+				controlCurrent[id] = modulated
+					? parameter.normalisedToReal(std::clamp(smoother[id].current + modulation.offset(id, s), 0.0, 1.0))
+					: parameter.normalisedToReal(smoother[id].current);
+			}
+
+			const int end = min(to, s + updateThreshold - phase);
+			const double increment = (controlCurrent[id] - controlPrevious[id]) * scale;
+
+			for (int i = phase + 1; s < end; ++s, ++i)
+				paramValue[id][s] = controlPrevious[id] + increment * double(i);
+		}
+
+		smoother[id].skip(to - consumed);
+	}
+
 	//------------------------------------------------------------------------
 	tresult PLUGIN_API Kwire2Processor::initialize(FUnknown* context)
 	{
@@ -81,6 +419,9 @@ namespace Kwire2 {
 		addAudioInput(STR16("Stereo In"), Steinberg::Vst::SpeakerArr::kStereo, Steinberg::Vst::BusTypes::kMain);
 		addAudioOutput(STR16("Stereo Out"), Steinberg::Vst::SpeakerArr::kStereo, Steinberg::Vst::BusTypes::kMain);
 
+		// Mod wheel and expression CCs reach the modulation through the controller's MIDI mapping.
+		addEventInput(STR16("Event In"), 1);
+
 		return kResultOk;
 	}
 
@@ -97,9 +438,111 @@ namespace Kwire2 {
 	tresult PLUGIN_API Kwire2Processor::setActive(TBool state)
 	{
 		//--- called when the Plug-in is enable/disable (On/Off) -----
+		// Process isn't running, a state published since the last block is taken up here. A block that
+		// was running when it came may have recorded automation of the same ids over it as the latest.
+		if (takeSnapshot())
+			parameterSnapshot.store(normalisedValue);
+
+		// Start from the current values instead of gliding from the ones before deactivation,
+		// and from a clear state. Nothing is prepared on the audio thread.
+
+		if (state)
+		{
+			prepareCrossover();
+			reset();
+			loadMeter.reset();
+			needsSnap = true;
+		}
+
+		if (dataExchange)
+		{
+			if (state)
+				dataExchange->onActivate(processSetup);
+			else
+				dataExchange->onDeactivate();
+		}
+
+		historyBlock = nullptr;
+		historySamples = 0;
+
 		return AudioEffect::setActive(state);
 	}
 
+	//------------------------------------------------------------------------
+	uint32 PLUGIN_API Kwire2Processor::getLatencySamples()
+	{
+		const int partition = requestedPartition();
+
+		return partition ? uint32(LinearPhaseCrossover::latency(sampleRate, partition)) : 0;
+	}
+
+	//------------------------------------------------------------------------
+	tresult PLUGIN_API Kwire2Processor::connect(IConnectionPoint* other)
+	{
+		const tresult result = AudioEffect::connect(other);
+
+		if (result == kResultTrue)
+		{
+			// Blocks are sent about every 10 ms of audio, the queue covers the UI thread falling behind.
+			const auto configure = [](DataExchangeHandler::Config& config, const ProcessSetup& setup) {
+				config.blockSize = sizeof(GainReductionHistory::Block);
+				config.numBlocks = 64;
+				config.alignment = 32;
+				config.userContextID = 0;
+				return true;
+			};
+
+			dataExchange = std::make_unique<DataExchangeHandler>(this, configure);
+			dataExchange->onConnect(other, getHostContext());
+		}
+
+		return result;
+	}
+
+	tresult PLUGIN_API Kwire2Processor::disconnect(IConnectionPoint* other)
+	{
+		if (dataExchange)
+		{
+			dataExchange->onDisconnect(other);
+			dataExchange.reset();
+		}
+
+		historyBlock = nullptr;
+
+		return AudioEffect::disconnect(other);
+	}
+
+	tresult PLUGIN_API Kwire2Processor::notify(IMessage* message)
+	{
+		if (message && FIDStringsEqual(message->getMessageID(), kPresetStateMessage))
+		{
+			const void* state;
+			uint32 stateSize;
+
+			if (message->getAttributes()->getBinary("state", state, stateSize) != kResultOk)
+				return kResultFalse;
+
+			// Same path as a state from the host.
+			MemoryStream stream(const_cast<void*>(state), stateSize);
+			return setState(&stream);
+		}
+
+		if (message && FIDStringsEqual(message->getMessageID(), kLatencyParameterMessage))
+		{
+			int64 id;
+			double value;
+
+			if (message->getAttributes()->getInt("id", id) != kResultOk || message->getAttributes()->getFloat("value", value) != kResultOk
+				|| id < 0 || id >= nTotalParams || !paramChangesLatency(ParamID(id)) || !(value >= 0.0 && value <= 1.0))
+				return kResultFalse;
+
+			setLatencyParameter(ParamID(id), value);
+			return kResultTrue;
+		}
+
+		return AudioEffect::notify(message);
+	}
+
 	//------------------------------------------------------------------------
 	tresult PLUGIN_API Kwire2Processor::setBusArrangements(Steinberg::Vst::SpeakerArrangement* inputs, Steinberg::int32 numIns, Steinberg::Vst::SpeakerArrangement* outputs, Steinberg::int32 numOuts)
 	{
@@ -128,148 +571,475 @@ namespace Kwire2 {
 	//------------------------------------------------------------------------
 
 	template<typename SampleType>
-	void Kwire2Processor::processAudio(void** in, void** out, const int samples, const double processSampleRate)
+	void Kwire2Processor::processDetector(void** in, const int samples, GainReductionStats* stats)
 	{
+		// Input at 0 dB only converts. Decided once per block outside the sample loop, like the
+		// output stages, but at runtime: bypass and analysis call this without classifyBlock.
+		const bool unityInput = paramIsConstant[inGainId] && realValue[inGainId] == 1.0;
+
 		// HP filter and envelope follower
 		for (int c = 0; c < 2; ++c)
 		{
 			const SampleType* inputPtr = static_cast<const SampleType*>(in[c]);
 
-			for (int s = 0; s < samples; ++s)
-				amplifiedInput[c][s] = static_cast<double>(inputPtr[s]) * paramValue[inGainId][s];
+			if (unityInput)
+			{
+				for (int s = 0; s < samples; ++s)
+					amplifiedInput[c][s] = static_cast<double>(inputPtr[s]);
+			}
+			else
+			{
+				for (int s = 0; s < samples; ++s)
+					amplifiedInput[c][s] = static_cast<double>(inputPtr[s]) * paramValue[inGainId][s];
+			}
 
-			// Saturate
-			distortion[c].process(amplifiedInput[c], samples);
+			// Saturate, High adds the oversampled curve
+			if (highActive)
+				distortion[c].process(amplifiedInput[c], samples, highMix);
+			else
+				distortion[c].process(amplifiedInput[c], samples);
 
-			for (int s = 0; s < samples; ++s)
+			if (linearPhase)
+				continue;
+
+			// Coefficients are only updated on control points, a period
+			// carried over from the previous block keeps its coefficients.
+			for (int start = 0, end = 0; start < samples; start = end)
 			{
-				const double cutoff = paramValue[crossoverId][s];
+				const int phase = (controlPhase + start) % updateThreshold;
+				end = min(samples, start + updateThreshold - phase);
 
-				if (cutoff != filter[c].cutoff)
-					filter[c].setCutoff(cutoff);
+				const double cutoff = paramValue[crossoverId][start];
 
-				filteredInput[c][s] = filter[c].process(amplifiedInput[c][s]);
+				if (phase == 0 && cutoff != filter[c].cutoff)
+					filter[c].setCutoff(cutoff, *sharedTables);
+
+				filter[c].process(amplifiedInput[c] + start, filteredInput[c] + start, end - start);
 			}
 		}
 
+		if (linearPhase)
+			processLinearCrossover<SampleType>(in, samples, !stats);
+
+		processSidechainEQ(samples);
+
 		// y = 1.0 - ratio * dbtoa(thresholdInDb - atodb(0.5 * (abs(inL) + abs(inR))))
-		for (int s = 0; s < samples; ++s)
-			rectifiedSignal[s] = abs(filteredInput[0][s]) + abs(filteredInput[1][s]);
+		if (!highActive)
+		{
+			for (int s = 0; s < samples; ++s)
+				rectifiedSignal[s] = abs(filteredInput[0][s]) + abs(filteredInput[1][s]);
+		}
+		else
+		{
+			// High detects the peaks between samples, from the input upsampled twice.
+			std::fill(rectifiedSignal, rectifiedSignal + samples, 0.0);
 
-		auto& difference = rectifiedSignal;
+			for (int c = 0; c < 2; ++c)
+			{
+				peakUpsampler[c].process(filteredInput[c], upsampledInput, samples);
 
-		for (int s = 0; s < samples; ++s)
-			difference[s] = min(0.0, paramValue[thresholdId][s] - atodb(rectifiedSignal[s]));
+				for (int s = 0; s < samples; ++s)
+				{
+					const double sample = abs(filteredInput[c][s]);
+					const double peak = max(abs(upsampledInput[2 * s]), abs(upsampledInput[2 * s + 1]));
 
-		auto& attenuation = difference;
+					rectifiedSignal[s] += sample + highMix[s] * (peak - sample);
+				}
+			}
+		}
 
-		for (int s = 0; s < samples; ++s)
-			attenuation[s] = dbtoa(difference[s] * paramValue[ratioId][s]);
+		// At high sample rates Eco and Normal run the gain computer and the envelopes once per group
+		// of samples, on the group's peak. The filter above stays at the full rate.
+		const bool decimate = decimation > 1 && !stats && !highActive;
 
-		// Slide times
-		for (int s = 0; s < samples; ++s)
-			attackInSamples[s] = max(1.0, paramValue[attackId][s] * 0.001 * processSampleRate);
+		if (decimate && !wasDecimated)
+		{
+			groupPhase = 0;
+			groupPeak = 0.0;
 
-		for (int s = 0; s < samples; ++s)
-			releaseInSamples[s] = max(1.0, paramValue[releaseId][s] * 0.001 * processSampleRate);
+			rampFrom[DualEnvelope::Mid] = rampTo[DualEnvelope::Mid] = envelopes.value(DualEnvelope::Mid);
+			rampFrom[DualEnvelope::Side] = rampTo[DualEnvelope::Side] = envelopes.value(DualEnvelope::Side);
+		}
 
-		// Generate envelope
-		auto& envelope = attenuation;
+		wasDecimated = decimate;
+		const int phase = groupPhase;
+
+		DetectorRows rows = {
+			rectifiedSignal, sideEnvelope,
+			paramValue[thresholdId], paramValue[ratioId], paramValue[kneeId],
+			paramValue[sideThresholdId], paramValue[sideRatioId],
+			paramValue[attackId], paramValue[releaseId], paramValue[sideAttackId], paramValue[sideReleaseId],
+			ecoMix
+		};
+		const int count = decimate ? decimateDetector(samples, rows) : samples;
+		const double stepRate = sampleRate / (decimate ? decimation : 1);
+
+		auto& attenuation = rows.level;
+
+		// The curve table is only valid for static settings, ramps use the analytic curve. A ramp can
+		// end where it started (automation points, modulation), so the whole block is checked.
+		const auto isStatic = [&](ParamID id) {
+			return paramIsConstant[id] || std::all_of(paramValue[id], paramValue[id] + samples, [&](double value) { return value == paramValue[id][0]; });
+		};
+		const bool staticCurve = isStatic(thresholdId) && isStatic(ratioId) && isStatic(kneeId);
+
+		// Analysis only reports the mid envelope, the side one isn't needed. The side curve is the mid
+		// one moved by the side settings; at their defaults it's the same and only copied.
+		const bool sideStatic = isStatic(sideThresholdId) && isStatic(sideRatioId);
+		const bool sideLinked = sideStatic && paramValue[sideThresholdId][0] == 0.0 && paramValue[sideRatioId][0] == 1.0;
+
+		// Before the mid curve, which overwrites the level.
+		if (!stats && !sideLinked)
+		{
+			for (int s = 0; s < count; ++s)
+				sideThreshold[s] = rows.threshold[s] + rows.sideThreshold[s];
 
-		for (int s = 0; s < samples; ++s)
+			for (int s = 0; s < count; ++s)
+				sideRatio[s] = rows.ratio[s] * rows.sideRatio[s];
+
+			GainComputer::Table* sideCurve = nullptr;
+
+			// Keyed from the parameter rows: a decimated block can have no group to fill sideThreshold with.
+			if (staticCurve && sideStatic)
+				sideCurve = sideGainComputer.tableFor({ paramValue[thresholdId][0] + paramValue[sideThresholdId][0],
+					paramValue[ratioId][0] * paramValue[sideRatioId][0], paramValue[kneeId][0] });
+
+			computeGain(sideCurve, rows, sideThreshold, sideRatio, rows.side, count);
+		}
+
+		if (stats)
+			stats->addDetectorLevel(rows.level, rows.threshold, samples);
+
+		GainComputer::Table* curve = nullptr;
+
+		if (staticCurve)
+			curve = gainComputer.tableFor({ paramValue[thresholdId][0], paramValue[ratioId][0], paramValue[kneeId][0] });
+
+		computeGain(curve, rows, rows.threshold, rows.ratio, attenuation, count);
+
+		if (!stats && sideLinked)
+			std::copy(attenuation, attenuation + count, rows.side);
+
+		// Slide times, the side ones scaled from the mid ones
+		for (int s = 0; s < count; ++s)
 		{
-			envelope[s] = slide(attenuation[s], envelopeZ1, attenuation[s] >= envelopeZ1 ? releaseInSamples[s] : attackInSamples[s]);
-			envelopeZ1 = envelope[s];
+			const double attack = rows.attack[s] * 0.001 * stepRate;
+			const double release = rows.release[s] * 0.001 * stepRate;
 
-			sideEnvelope[s] = slide(attenuation[s], envelopeZ1, attenuation[s] >= envelopeZ1 ? releaseInSamples[s] * 2.0 : attackInSamples[s] * 3.0);
-			sideEnvelopeZ1 = sideEnvelope[s];
+			envelopes.setTimes(s, DualEnvelope::Mid, attack, release);
+			envelopes.setTimes(s, DualEnvelope::Side, attack * rows.sideAttack[s], release * rows.sideRelease[s]);
 		}
 
+		// Generate envelopes, in place
+		if (stats)
+		{
+			envelopes.processMid(attenuation, samples);
+			stats->addEnvelope(attenuation, samples);
+			return;
+		}
+
+		envelopes.process(attenuation, rows.side, count);
+
+		if (decimate)
+			expandDetector(samples, phase, rows);
+	}
+
+	template<typename SampleType>
+	void Kwire2Processor::processLinearCrossover(void** in, const int samples, const bool delayAudio)
+	{
+		// Redesigned from the cutoff at the start of the block, when it moved.
+		linearCrossover.setCutoff(paramValue[crossoverId][0], filter[0].resonance);
+		linearCrossover.process(amplifiedInput[0], amplifiedInput[1], filteredInput[0], filteredInput[1], samples);
+
+		// Analysis doesn't write audio.
+		if (!delayAudio)
+			return;
+
 		for (int c = 0; c < 2; ++c)
 		{
-			for (int s = 0; s < samples; ++s)
-				wetSignal[c][s] = amplifiedInput[c][s];
+			wetDelay[c].process(amplifiedInput[c], amplifiedInput[c], samples);
+			dryDelay[c].process(static_cast<const SampleType*>(in[c]), static_cast<SampleType*>(delayedInput[c]), samples);
 		}
+	}
 
-		// LR -> MS
-		for (int s = 0; s < samples; ++s)
+	void Kwire2Processor::updateSidechainEQ(const int s)
+	{
+		for (int band = 0; band < SidechainEQ::BANDS; ++band)
+		{
+			const ParamID offset = band * EQ_BAND_PARAMS;
+			const int type = std::clamp(int(lround(paramValue[eq1TypeId + offset][s])), int(SidechainEQ::Off), SidechainEQ::NumTypes - 1);
+
+			sidechainEQ.setBand(band, SidechainEQ::Type(type), paramValue[eq1FrequencyId + offset][s],
+				paramValue[eq1GainId + offset][s], paramValue[eq1QId + offset][s]);
+		}
+	}
+
+	void Kwire2Processor::processSidechainEQ(const int samples)
+	{
+		// Settled bands have the same settings on every control point, only the block's first one is
+		// taken. They cost nothing while they're all off.
+		if (std::all_of(paramIsConstant + eq1TypeId, paramIsConstant + nEqEnd, [](bool constant) { return constant; }))
+		{
+			const int first = min(samples, (updateThreshold - controlPhase) % updateThreshold);
+
+			if (sidechainEQ.isActive())
+				sidechainEQ.process(filteredInput[0], filteredInput[1], first);
+
+			if (first == samples)
+				return;
+
+			updateSidechainEQ(first);
+
+			if (sidechainEQ.isActive())
+				sidechainEQ.process(filteredInput[0] + first, filteredInput[1] + first, samples - first);
+
+			return;
+		}
+
+		for (int start = 0, end = 0; start < samples; start = end)
 		{
-			const double mid = 0.5 * (wetSignal[0][s] + wetSignal[1][s]);
-			const double side = 0.5 * (wetSignal[0][s] - wetSignal[1][s]);
+			const int phase = (controlPhase + start) % updateThreshold;
+			end = min(samples, start + updateThreshold - phase);
+
+			if (phase == 0)
+				updateSidechainEQ(start);
 
-			wetSignal[0][s] = mid;
-			wetSignal[1][s] = side;
+			if (sidechainEQ.isActive())
+				sidechainEQ.process(filteredInput[0] + start, filteredInput[1] + start, end - start);
 		}
+	}
+
+	int Kwire2Processor::decimateDetector(const int samples, DetectorRows& rows)
+	{
+		int count = 0;
 
-		// Attenuated signal
 		for (int s = 0; s < samples; ++s)
-			wetSignal[0][s] *= envelope[s];
+		{
+			groupPeak = max(groupPeak, rectifiedSignal[s]);
+
+			if (++groupPhase < decimation)
+				continue;
+
+			decimatedRows[LevelRow][count] = groupPeak;
+			groupEnd[count++] = s;
+
+			groupPhase = 0;
+			groupPeak = 0.0;
+		}
+
+		// Parameters as they are on the last sample of each group.
+		const auto gather = [&](DecimatedRow row, const double* source) {
+			for (int k = 0; k < count; ++k)
+				decimatedRows[row][k] = source[groupEnd[k]];
+
+			return decimatedRows[row];
+		};
+
+		rows.level = decimatedRows[LevelRow];
+		rows.side = decimatedRows[SideRow];
+		rows.threshold = gather(ThresholdRow, rows.threshold);
+		rows.ratio = gather(RatioRow, rows.ratio);
+		rows.knee = gather(KneeRow, rows.knee);
+		rows.sideThreshold = gather(SideThresholdRow, rows.sideThreshold);
+		rows.sideRatio = gather(SideRatioRow, rows.sideRatio);
+		rows.attack = gather(AttackRow, rows.attack);
+		rows.release = gather(ReleaseRow, rows.release);
+		rows.sideAttack = gather(SideAttackRow, rows.sideAttack);
+		rows.sideRelease = gather(SideReleaseRow, rows.sideRelease);
+
+		if (ecoActive)
+			rows.eco = gather(EcoRow, rows.eco);
+
+		return count;
+	}
+
+	void Kwire2Processor::expandDetector(const int samples, int phase, const DetectorRows& rows)
+	{
+		const double step = 1.0 / double(decimation);
+		int group = 0;
 
 		for (int s = 0; s < samples; ++s)
-			wetSignal[1][s] *= sideEnvelope[s];
+		{
+			if (++phase == decimation)
+			{
+				phase = 0;
+
+				rampFrom[DualEnvelope::Mid] = rampTo[DualEnvelope::Mid];
+				rampFrom[DualEnvelope::Side] = rampTo[DualEnvelope::Side];
+				rampTo[DualEnvelope::Mid] = rows.level[group];
+				rampTo[DualEnvelope::Side] = rows.side[group];
+				++group;
+			}
+
+			const double position = double(phase) * step;
+
+			rectifiedSignal[s] = rampFrom[DualEnvelope::Mid] + position * (rampTo[DualEnvelope::Mid] - rampFrom[DualEnvelope::Mid]);
+			sideEnvelope[s] = rampFrom[DualEnvelope::Side] + position * (rampTo[DualEnvelope::Side] - rampFrom[DualEnvelope::Side]);
+		}
+	}
+
+	void Kwire2Processor::computeGain(const GainComputer::Table* curve, const DetectorRows& rows, const double* threshold,
+		const double* ratio, double* attenuation, const int count)
+	{
+		const double* level = rows.level;
+		const double* knee = rows.knee;
+
+		// High always uses the analytic curve, Eco uses the fast one in place of it. High only runs at the full rate.
+		if (curve && !fullyHigh)
+		{
+			for (int s = 0; s < count; ++s)
+				attenuation[s] = GainComputer::lookup(*curve, level[s]);
 
-		// MS -> LR
+			if (highActive)
+			{
+				for (int s = 0; s < count; ++s)
+					attenuation[s] += highMix[s] * (GainComputer::gain(level[s], threshold[s], ratio[s], knee[s]) - attenuation[s]);
+			}
+		}
+		else if (!curve && fullyEco)
+		{
+			for (int s = 0; s < count; ++s)
+				attenuation[s] = GainComputer::fastGain(level[s], threshold[s], ratio[s], knee[s]);
+		}
+		else
+		{
+			for (int s = 0; s < count; ++s)
+				attenuation[s] = GainComputer::gain(level[s], threshold[s], ratio[s], knee[s]);
+
+			if (!curve && ecoActive)
+			{
+				for (int s = 0; s < count; ++s)
+					attenuation[s] += rows.eco[s] * (GainComputer::fastGain(level[s], threshold[s], ratio[s], knee[s]) - attenuation[s]);
+			}
+		}
+	}
+
+	template<typename SampleType, int Features>
+	void Kwire2Processor::processAudio(void** in, void** out, const int samples)
+	{
+		constexpr bool automated = Features & Automated;
+
+		processDetector<SampleType>(in, samples);
+
+		// The dry signal lines up with the wet one. Bypass passes the same signal through untouched.
+		void** bypassed = linearPhase ? delayedInput : in;
+		void** dry = bypassed;
+
+		// High's saturation runs through the halfband filters, the dry signal follows their phase.
+		if (highActive)
+		{
+			for (int c = 0; c < 2; ++c)
+				dryRoundTrip[c].process(static_cast<const SampleType*>(bypassed[c]), static_cast<SampleType*>(alignedInput[c]), samples, highMix);
+
+			dry = alignedInput;
+		}
+
+		// Constant parameters are read once, their rows hold the same value.
+		const auto value = [&](ParamID id, int s) {
+			if constexpr (automated)
+				return paramValue[id][s];
+			else
+				return realValue[id];
+		};
+
+		// LR -> MS, attenuated, MS -> LR
 		for (int s = 0; s < samples; ++s)
 		{
-			const double mid = wetSignal[0][s];
-			const double side = wetSignal[1][s];
+			const double mid = 0.5 * (amplifiedInput[0][s] + amplifiedInput[1][s]) * rectifiedSignal[s];
+			const double side = 0.5 * (amplifiedInput[0][s] - amplifiedInput[1][s]) * sideEnvelope[s];
 
 			wetSignal[0][s] = mid + side;
 			wetSignal[1][s] = mid - side;
 		}
 
 		// Soft-ish clipping
-		for (int c = 0; c < 2; ++c)
+		if constexpr ((Features & ClipStage) != 0)
 		{
-			for (int s = 0; s < samples; ++s)
-			{	
-				constexpr double factor = 0.85;
-				const double q = max(0.0, paramValue[clipThresholdId][s] - (1.0 - factor));
+			for (int c = 0; c < 2; ++c)
+			{
+				for (int s = 0; s < samples; ++s)
+				{
+					constexpr double factor = 0.85;
+					const double q = max(0.0, value(clipThresholdId, s) - (1.0 - factor));
 
-				const double clamped = std::clamp(wetSignal[c][s], -q, q);
-				const double out = clamped + cheapTanh((wetSignal[c][s] - clamped) / (1.0 - factor)) * (1.0 - factor);
+					const double clamped = std::clamp(wetSignal[c][s], -q, q);
+					const double out = clamped + cheapTanh((wetSignal[c][s] - clamped) / (1.0 - factor)) * (1.0 - factor);
 
-				wetSignal[c][s] = (1.0 - paramValue[clipMixId][s]) * wetSignal[c][s] + paramValue[clipMixId][s] * out;
+					wetSignal[c][s] = (1.0 - value(clipMixId, s)) * wetSignal[c][s] + value(clipMixId, s) * out;
+				}
 			}
 		}
 
 		// Mix
 		// y = mix * outGain * out + (1 - mix) * in
+		// Mix takes the untouched input signal (not affected by input gain)
 		for (int c = 0; c < 2; ++c)
 		{
-			for (int s = 0; s < samples; ++s)
-				wetSignal[c][s] *= paramValue[outGainId][s];
+			const SampleType* inputPtr = static_cast<const SampleType*>(dry[c]);
+			SampleType* outputPtr = static_cast<SampleType*>(out[c]);
 
-			for (int s = 0; s < samples; ++s)
-				wetSignal[c][s] *= paramValue[mixId][s];
+			if constexpr (!automated)
+				mixConstant<(Features & DryStage) != 0, (Features & GainStage) != 0>(outputPtr, inputPtr, wetSignal[c], realValue[mixId], realValue[outGainId], samples);
+			else if (!paramIsConstant[bypassId])
+				mixCrossfade(outputPtr, inputPtr, static_cast<const SampleType*>(bypassed[c]), wetSignal[c], paramValue[mixId], paramValue[outGainId], paramValue[bypassId], samples);
+			else if constexpr ((Features & DryStage) == 0)
+				mixWetOnly(outputPtr, wetSignal[c], paramValue[outGainId], samples);
+			else if (inputPtr == outputPtr)
+				mixInPlace(outputPtr, wetSignal[c], paramValue[mixId], paramValue[outGainId], samples);
+			else
+				mixOutOfPlace(outputPtr, inputPtr, wetSignal[c], paramValue[mixId], paramValue[outGainId], samples);
+		}
+	}
+
+	int Kwire2Processor::classifyBlock() const
+	{
+		const auto constantAt = [&](ParamID id, double value) {
+			return paramIsConstant[id] && realValue[id] == value;
+		};
 
-			// Mix takes the untouched input signal (not affected by input gain)
-			SampleType* inputPtr = static_cast<SampleType*>(in[c]);
+		int features = 0;
 
-			for (int s = 0; s < samples; ++s)
-				inputPtr[s] = static_cast<SampleType>(static_cast<double>(inputPtr[s]) * (1.0 - paramValue[mixId][s]));
+		if (!constantAt(clipMixId, 0.0))
+			features |= ClipStage;
 
-			SampleType* outputPtr = static_cast<SampleType*>(out[c]);
+		if (!constantAt(mixId, 1.0))
+			features |= DryStage;
 
-			for (int s = 0; s < samples; ++s)
-				outputPtr[s] = static_cast<SampleType>(wetSignal[c][s] + static_cast<double>(inputPtr[s]));
+		if (!constantAt(outGainId, 1.0))
+			features |= GainStage;
+
+		for (ParamID id : { bypassId, clipMixId, clipThresholdId, mixId, outGainId })
+		{
+			if (!paramIsConstant[id])
+				features |= Automated;
 		}
+
+		return features;
 	}
 
-	tresult PLUGIN_API Kwire2Processor::process(Vst::ProcessData& data)
+	void Kwire2Processor::beginBlock(Vst::ProcessData& data)
 	{
-		assert(data.processContext != nullptr);
-
 		const int samples = data.numSamples;
-		const double processSampleRate = data.processContext->sampleRate;
 
 		assert(MAX_BUFFER_SIZE >= samples);
 
-		for (int32 id = 0; id < nParams; ++id)
-			std::fill(paramValue[id], paramValue[id] + MAX_BUFFER_SIZE, realValue[id]);
+		takeSnapshot();
 
-		if (data.processContext && sampleRate != processSampleRate)
-			setSampleRate(processSampleRate);
+		if (needsSnap)
+		{
+			snapParameters();
+			needsSnap = false;
+		}
+
+		// A new quality restarts the control grid at its own rate.
+		if (const Quality tier = effectiveQuality(); tier != quality)
+		{
+			quality = tier;
+			updateThreshold = controlInterval(quality, sampleRate);
+			controlPhase = 0;
+		}
+
+		bool hasPoints[nTotalParams] = { false };
 
 		if (data.inputParameterChanges)
 		{
@@ -282,44 +1052,159 @@ namespace Kwire2 {
 					// Make clean point list from parameter queue.
 					const ParamID id = paramQueue->getParameterId();
 
-					// Only process incoming data from user parameters.
-					if (id >= nParams)
-						continue;
-
-					if (paramPointQueue[id].fromParamQueue(paramQueue) <= 0)
+					// Only process incoming data from plugin parameters.
+					if (id >= nTotalParams)
 						continue;
 
-					auto it = paramPointQueue[id].pointQueue.end();
-					--it;
-
-					const ParamValue val = it->second;
-
-					// Long ramp from start to end of the buffer.
-					if (val == normalisedValue[id])
-					{
-						std::fill(paramValue[id], paramValue[id] + MAX_BUFFER_SIZE, realValue[id]);
-					}
-					else
-					{
-						for (int s = 0; s < samples; ++s)
-						{
-							const double t = double(s + 1) / double(samples);
-							paramValue[id][s] = customParameters[id].normalisedToReal(herp(normalisedValue[id], val, t));
-						}
-
-						setParameterNormalised(id, val);
-					}
+					hasPoints[id] = paramPointQueue[id].fromParamQueue(paramQueue) > 0;
 				}
 			}
 		}
 
+		// The modulation sources and slots first, the user parameters read them at their control points.
+		// The side settings aren't modulated and come along.
+		for (ParamID id = nParams; id < nTotalParams; ++id)
+			updateParameter(id, hasPoints[id] ? &paramPointQueue[id] : nullptr, samples);
+
+		updateModulation(data, samples);
+
+		for (ParamID id = 0; id < nParams; ++id)
+			updateParameter(id, hasPoints[id] ? &paramPointQueue[id] : nullptr, samples);
+
+		updateQualityMix(samples);
+	}
+
+	void Kwire2Processor::updateModulation(Vst::ProcessData& data, int samples)
+	{
+		for (int slot = 0; slot < Modulation::SLOTS; ++slot)
+		{
+			const ParamID offset = slot * MOD_SLOT_PARAMS;
+			const int source = std::clamp(int(lround(realValue[mod1SourceId + offset])), int(Modulation::Off), Modulation::NumSources - 1);
+			const int destination = std::clamp(int(lround(realValue[mod1DestinationId + offset])), 0, int(std::size(modDestinations)) - 1);
+
+			modulation.setSlot(slot, Modulation::Source(source), int(modDestinations[destination]), paramValue[mod1AmountId + offset]);
+		}
+
+		// First control point of the block, as renderParameter counts them.
+		const int first = (updateThreshold - controlPhase) % updateThreshold;
+		void** in = getChannelBuffersPointer(processSetup, data.inputs[0]);
+
+		if (data.symbolicSampleSize == Vst::kSample64)
+			modulation.evaluate(reinterpret_cast<double**>(in), samples, first, updateThreshold,
+				paramValue[modWheelId], paramValue[expressionId], paramValue[lfoRateId], paramValue[followerReleaseId]);
+		else
+			modulation.evaluate(reinterpret_cast<float**>(in), samples, first, updateThreshold,
+				paramValue[modWheelId], paramValue[expressionId], paramValue[lfoRateId], paramValue[followerReleaseId]);
+	}
+
+	void Kwire2Processor::sendHistory(int samples, bool processed)
+	{
+		using namespace GainReductionHistory;
+
+		if (!dataExchange)
+			return;
+
+		// Frames sent per block, about 10 ms.
+		const uint32_t framesPerBlock = std::clamp(uint32_t(0.01 * sampleRate / FRAME_SAMPLES), 1u, uint32_t(Block::MAX_FRAMES));
+
+		for (int s = 0; s < samples; ++s)
+		{
+			// The mid envelope is left in rectifiedSignal.
+			const double gain = processed ? rectifiedSignal[s] : 1.0;
+			const double level = processed ? max(abs(amplifiedInput[0][s]), abs(amplifiedInput[1][s])) : 0.0;
+
+			historyGainMin = historySamples ? min(historyGainMin, gain) : gain;
+			historyGainMax = historySamples ? max(historyGainMax, gain) : gain;
+			historyPeak = historySamples % PEAK_SAMPLES ? max(historyPeak, level) : level;
+
+			if (++historySamples % PEAK_SAMPLES == 0)
+			{
+				historyLevelMin = historySamples > PEAK_SAMPLES ? min(historyLevelMin, historyPeak) : historyPeak;
+				historyLevelMax = historySamples > PEAK_SAMPLES ? max(historyLevelMax, historyPeak) : historyPeak;
+			}
+
+			if (historySamples < FRAME_SAMPLES)
+				continue;
+
+			historySamples = 0;
+
+			if (!historyBlock)
+			{
+				// A full queue drops frames rather than waiting for the UI thread.
+				const DataExchangeBlock block = dataExchange->getCurrentOrNewBlock();
+
+				if (block.blockID == InvalidDataExchangeBlockID)
+					continue;
+
+				historyBlock = static_cast<Block*>(block.data);
+				historyBlock->sampleRate = sampleRate;
+				historyBlock->numFrames = 0;
+			}
+
+			historyBlock->frames[historyBlock->numFrames++] = { float(-atodb(historyGainMax)), float(-atodb(historyGainMin)),
+				float(atodb(max(historyLevelMin, 1e-6))), float(atodb(max(historyLevelMax, 1e-6))) };
+
+			if (historyBlock->numFrames >= framesPerBlock)
+			{
+				const LoadMeter::Reading load = loadMeter.reading();
+				historyBlock->load = load.average;
+				historyBlock->loadPeak = load.peak;
+
+				dataExchange->sendCurrentBlock();
+				historyBlock = nullptr;
+			}
+		}
+	}
+
+	void Kwire2Processor::endBlock(int samples)
+	{
+		controlPhase = (controlPhase + samples) % updateThreshold;
+		parameterSnapshot.record(normalisedValue);
+	}
+
+	//------------------------------------------------------------------------
+	tresult PLUGIN_API Kwire2Processor::process(Vst::ProcessData& data)
+	{
+		RealtimeAudit::Scope audit;
+		SignalGuard::DenormalScope denormals;
+		const LoadMeter::Clock::time_point started = loadMeter.start();
+
+		beginBlock(data);
+
+		const int samples = data.numSamples;
+		const bool is64 = data.symbolicSampleSize == Vst::kSample64;
+
 		void** in = getChannelBuffersPointer(processSetup, data.inputs[0]);
 		void** out = getChannelBuffersPointer(processSetup, data.outputs[0]);
 		const uint32 sampleFramesSize = getSampleFramesSizeInBytes(processSetup, samples);
+		bool processed = false;
 
-		if (data.inputs[0].silenceFlags == getChannelMask(data.inputs[0].numChannels))
+		if (paramIsConstant[bypassId] && realValue[bypassId] == 1.0)
 		{
-			// No amplifiedInput, no wetSignal.
+			// Fully bypassed, pass the input through untouched. The linear phase crossover delays it,
+			// and needs the detector to keep its delay lines going.
+			data.outputs[0].silenceFlags = linearPhase ? 0 : data.inputs[0].silenceFlags;
+
+			if (linearPhase || lround(realValue[bypassDetectorId]) == DetectorRunning)
+			{
+				if (is64)
+					processDetector<double>(guardInput<double>(in, samples), samples);
+				else if (data.symbolicSampleSize == Vst::kSample32)
+					processDetector<float>(guardInput<float>(in, samples), samples);
+			}
+
+			void** source = linearPhase ? delayedInput : in;
+
+			for (int32 c = 0; c < data.outputs[0].numChannels; c++)
+			{
+				if (out[c] != source[c])
+					memcpy(out[c], source[c], sampleFramesSize);
+			}
+		}
+		else if (!linearPhase && data.inputs[0].silenceFlags == getChannelMask(data.inputs[0].numChannels))
+		{
+			// No amplifiedInput, no wetSignal. With the linear phase crossover the delay lines still
+			// hold signal, silence is processed.
 			data.outputs[0].silenceFlags = data.inputs[0].silenceFlags;
 
 			for (int32 c = 0; c < data.outputs[0].numChannels; c++)
@@ -328,20 +1213,66 @@ namespace Kwire2 {
 		else
 		{
 			data.outputs[0].silenceFlags = 0;
+			processed = true;
+
+			static constexpr auto variants64 = audioVariants<double>(std::make_integer_sequence<int, NumAudioVariants>());
+			static constexpr auto variants32 = audioVariants<float>(std::make_integer_sequence<int, NumAudioVariants>());
+			const int features = classifyBlock();
 
-			if (data.symbolicSampleSize == Vst::kSample64)
-				processAudio<double>(in, out, samples, processSampleRate);
+			if (is64)
+				(this->*variants64[features])(guardInput<double>(in, samples), out, samples);
 			else if (data.symbolicSampleSize == Vst::kSample32)
-				processAudio<float>(in, out, samples, processSampleRate);
+				(this->*variants32[features])(guardInput<float>(in, samples), out, samples);
 		}
 
+		guardState();
+
+		// Checked every block: a recursion that failed during the block may have reached the output,
+		// and a finite input may overflow it, eg. 3e38 with the input gain up in 32 bit.
+		if (processed)
+		{
+			if (is64)
+				guardOutput<double>(out, samples);
+			else if (data.symbolicSampleSize == Vst::kSample32)
+				guardOutput<float>(out, samples);
+		}
+
+		sendHistory(samples, processed);
+		endBlock(samples);
+
+		loadMeter.stop(started, samples, sampleRate);
+
 		return kResultOk;
 	}
 
+	//------------------------------------------------------------------------
+	void Kwire2Processor::analyse(Vst::ProcessData& data, GainReductionStats& stats)
+	{
+		RealtimeAudit::Scope audit;
+		SignalGuard::DenormalScope denormals;
+
+		beginBlock(data);
+
+		void** in = getChannelBuffersPointer(processSetup, data.inputs[0]);
+
+		if (data.symbolicSampleSize == Vst::kSample64)
+			processDetector<double>(in, data.numSamples, &stats);
+		else if (data.symbolicSampleSize == Vst::kSample32)
+			processDetector<float>(in, data.numSamples, &stats);
+
+		endBlock(data.numSamples);
+	}
+
 	//------------------------------------------------------------------------
 	tresult PLUGIN_API Kwire2Processor::setupProcessing(Vst::ProcessSetup& newSetup)
 	{
 		//--- called before any processing ----
+		setSampleRate(newSetup.sampleRate);
+
+		// Offline renders take the curve deterministically.
+		gainComputer.setSynchronous(newSetup.processMode == Vst::kOffline);
+		sideGainComputer.setSynchronous(newSetup.processMode == Vst::kOffline);
+
 		return AudioEffect::setupProcessing(newSetup);
 	}
 
@@ -363,6 +1294,10 @@ namespace Kwire2 {
 		IBStreamer streamer(state, kLittleEndian);
 		std::string paramTitle;
 
+		// Runs next to process, so the values go through the snapshot rather than into the arrays process reads.
+		std::lock_guard<std::mutex> lock(stateMutex);
+		ParameterSnapshot::State& snapshot = parameterSnapshot.beginWrite();
+
 		while (true)
 		{
 			auto identifier = streamer.readStr8();
@@ -382,9 +1317,11 @@ namespace Kwire2 {
 			if (!streamer.readDouble(value))
 				continue;
 
-			setParameterNormalised(parameter->id, parameter->plainToNormalised(value));
+			snapshot.set(parameter->id, parameter->plainToNormalised(value));
 		}
 
+		publishSnapshot(snapshot);
+
 		return kResultOk;
 	}
 
@@ -396,7 +1333,7 @@ namespace Kwire2 {
 		for (CustomParameter& parameter : customParameters)
 		{
 			if (!streamer.writeStr8(parameter.title.c_str())) return kResultFalse;
-			if (!streamer.writeDouble(parameter.normalisedToPlain(normalisedValue[parameter.id]))) return kResultFalse;
+			if (!streamer.writeDouble(parameter.normalisedToPlain(parameterSnapshot.latestValue(parameter.id)))) return kResultFalse;
 		}
 
 		return kResultOk;
@@ -1,12 +1,34 @@
 #pragma once
 
+#include <array>
+#include <memory>
+#include <mutex>
+#include <utility>
+
 #include "public.sdk/source/vst/vstaudioeffect.h"
+#include "public.sdk/source/vst/utility/dataexchange.h"
 #include "pluginterfaces/vst/ivstparameterchanges.h"
 
 #include "parameters.h"
 #include "ParamPointQueue.h"
+#include "ParameterSnapshot.h"
+#include "ParamSmoother.h"
 #include "TPTSVF.h"
+#include "LinearPhaseCrossover.h"
+#include "DelayLine.h"
+#include "SidechainEQ.h"
 #include "Distortion.h"
+#include "Halfband.h"
+#include "GainComputer.h"
+#include "DualEnvelope.h"
+#include "SharedTables.h"
+#include "DryWetMix.h"
+#include "GainReductionStats.h"
+#include "GainReductionHistory.h"
+#include "LoadMeter.h"
+#include "Modulation.h"
+#include "RealtimeAudit.h"
+#include "SignalGuard.h"
 
 namespace Kwire2 {
 
@@ -37,8 +59,18 @@ public:
 	/** Switch the Plug-in on/off */
 	Steinberg::tresult PLUGIN_API setActive (Steinberg::TBool state) SMTG_OVERRIDE;
 
+	/** Connection to the controller, carries the gain reduction history */
+	Steinberg::tresult PLUGIN_API connect (Steinberg::Vst::IConnectionPoint* other) SMTG_OVERRIDE;
+	Steinberg::tresult PLUGIN_API disconnect (Steinberg::Vst::IConnectionPoint* other) SMTG_OVERRIDE;
+
+	/** Presets applied by the controller, a whole state at once */
+	Steinberg::tresult PLUGIN_API notify (Steinberg::Vst::IMessage* message) SMTG_OVERRIDE;
+
 	Steinberg::tresult PLUGIN_API setBusArrangements(Steinberg::Vst::SpeakerArrangement* inputs, Steinberg::int32 numIns, Steinberg::Vst::SpeakerArrangement* outputs, Steinberg::int32 numOuts) SMTG_OVERRIDE;
 
+	/** Latency of the linear phase crossover as the parameters are now, the next activation uses it */
+	Steinberg::uint32 PLUGIN_API getLatencySamples () SMTG_OVERRIDE;
+
 	/** Will be called before any process call */
 	Steinberg::tresult PLUGIN_API setupProcessing (Steinberg::Vst::ProcessSetup& newSetup) SMTG_OVERRIDE;
 	
@@ -52,38 +84,264 @@ public:
 	Steinberg::tresult PLUGIN_API setState (Steinberg::IBStream* state) SMTG_OVERRIDE;
 	Steinberg::tresult PLUGIN_API getState (Steinberg::IBStream* state) SMTG_OVERRIDE;
 
+	/** Runs only the detector over a block and adds its gain reduction to stats. No output is written. */
+	void analyse (Steinberg::Vst::ProcessData& data, GainReductionStats& stats);
+
+	/** Samples between control points common to every quality, and a multiple of the detector's
+	    decimation. Processing started on a multiple of it updates its parameters and groups the
+	    detector on the same samples as processing started at 0. */
+	static int controlAlignment (double sampleRate);
+
+	/** Samples per detector step at Eco and Normal: 2, 4 or 8 from 88.2 kHz up, to stay at 44.1 or 48 kHz. */
+	static int detectorDecimation (double sampleRate);
+
+	/** Time spent in process relative to the audio processed, averaged and peak. From any thread. */
+	LoadMeter::Reading load () const { return loadMeter.reading(); }
+
+	/** Blocks whose input or output was repaired, and recursions cleared, see SignalGuard. From any thread. */
+	const SignalGuard::Counters& faults () const { return guardCounters; }
+
 //------------------------------------------------------------------------
 protected:
+	// Output stages a block needs. Every combination is a processAudio variant, picked per block
+	// by classifyBlock through a table, so stages a block doesn't use cost nothing.
+	enum AudioFeatures {
+		ClipStage = 1,	// Clip Mix above 0%.
+		DryStage = 2,	// Mix below 100%.
+		GainStage = 4,	// Output other than 0 dB.
+		Automated = 8,	// Bypass, clip, mix or output moving, read per sample.
+		NumAudioVariants = 16
+	};
+
+	template<typename SampleType, int Features>
+	void processAudio(void** in, void** out, int samples);
+
+	using AudioVariant = void (Kwire2Processor::*)(void** in, void** out, int samples);
+
+	template<typename SampleType, int... Features>
+	static constexpr std::array<AudioVariant, sizeof...(Features)> audioVariants(std::integer_sequence<int, Features...>)
+	{
+		return { &Kwire2Processor::processAudio<SampleType, Features>... };
+	}
+
+	int classifyBlock() const;
+
+	// Input gain, saturation, crossover, gain computer and envelopes.
+	// Leaves the mid envelope in rectifiedSignal and the side envelope in sideEnvelope.
+	template<typename SampleType>
+	void processDetector(void** in, int samples, GainReductionStats* stats = nullptr);
+
+	// The crossover as a linear phase FIR, with the wet signal and the input into delayedInput delayed to
+	// match unless delayAudio is false.
 	template<typename SampleType>
-	void processAudio(void** in, void** out, int samples, double processSampleRate);
+	void processLinearCrossover(void** in, int samples, bool delayAudio);
+
+	// Sidechain EQ over filteredInput, its settings taken on control points like the crossover's.
+	void processSidechainEQ(int samples);
+	void updateSidechainEQ(int s);
+
+	// Rows the gain computer and the envelopes run on, at the full or the decimated rate.
+	struct DetectorRows {
+		double* level;	// Overwritten with the mid attenuation, then the mid envelope.
+		double* side;	// Side attenuation, then the side envelope.
+		const double* threshold;
+		const double* ratio;
+		const double* knee;
+		const double* sideThreshold;
+		const double* sideRatio;
+		const double* attack;
+		const double* release;
+		const double* sideAttack;
+		const double* sideRelease;
+		const double* eco;
+	};
+
+	// Static curve of rows.level, from curve when given and blended for the quality.
+	// attenuation may be rows.level.
+	void computeGain(const GainComputer::Table* curve, const DetectorRows& rows, const double* threshold,
+		const double* ratio, double* attenuation, int count);
+
+	// Peak of every group of decimation samples and the parameters at its end, pointed to by rows.
+	// Returns the number of groups completed in the block.
+	int decimateDetector(int samples, DetectorRows& rows);
+
+	// Ramps the decimated envelopes back to the full rate, lagging a group. phase is groupPhase at the start of the block.
+	void expandDetector(int samples, int phase, const DetectorRows& rows);
+
+	// Parameter and state updates shared by process and analyse.
+	void beginBlock(Steinberg::Vst::ProcessData& data);
+	void endBlock(int samples);
+
+	// Offline bounces use High whatever the Quality parameter says, unless Offline Quality follows it.
+	bool offlineUsesHigh() const;
+
+	// Quality in use for the block, and the per sample amount of Eco and High while crossfading.
+	Quality effectiveQuality() const;
+	void updateQualityMix(int samples);
+	static int controlInterval(Quality tier, double sr);
+
+	// Summarises the block into history frames for the editor. Without processed audio
+	// (bypass, silence) the frames show no gain reduction and no level.
+	void sendHistory(int samples, bool processed);
+
+	// Routes the modulation slots and evaluates their sources for the block, between the
+	// internal parameters and the ones they modulate.
+	void updateModulation(Steinberg::Vst::ProcessData& data, int samples);
 
 	void setParameterNormalised(ParamID id, double value);
+	void snapParameters();
+
+	// Audio thread, or setActive while process isn't running. Takes up a state published by setState or
+	// a latency parameter message, returns false if there's none.
+	bool takeSnapshot();
+
+	// Writer, under stateMutex. Maps the state filled since beginWrite to real values and publishes it.
+	void publishSnapshot(ParameterSnapshot::State& snapshot);
+
+	// Writer. A parameter the controller changed the latency with, ahead of the restart.
+	void setLatencyParameter(ParamID id, double value);
+
+	void updateParameter(ParamID id, ParamPointQueue* points, int samples);
+	void renderParameter(ParamID id, int from, int to);
 	
+	// Sample rate dependent preparation, from setupProcessing, and the DSP state, from setActive.
 	void setSampleRate(double sr);
+	void reset();
 	double sampleRate = 44100.0;
 
-	double paramValue[nParams][MAX_BUFFER_SIZE];
-	double normalisedValue[nParams] = { 0.0 };
-	double realValue[nParams] = { 0.0 };
-	ParamPointQueue paramPointQueue[nParams];
+	// NaN and Inf containment, see SignalGuard. guardInput returns the input, or a repaired copy of it.
+	// guardState recovers the recursions and returns false if they weren't finite.
+	template <typename SampleType>
+	void** guardInput(void** in, int samples);
+	template <typename SampleType>
+	void guardOutput(void** out, int samples);
+	bool guardState();
+
+	// Clears the recursions after a non-finite state, the same as reset. Parameters are kept.
+	void recover();
+
+	// Partition of the linear phase crossover the parameters ask for, 0 for minimum phase. prepareCrossover
+	// latches it from setActive, it changes the latency and allocates.
+	int requestedPartition() const;
+	void prepareCrossover();
+
+	SignalGuard::Counters guardCounters;
+	alignas(BUFFER_ALIGNMENT) double guardedSamples[2][MAX_BUFFER_SIZE];
+	void* guardedInput[2] = { guardedSamples[0], guardedSamples[1] };
+
+	alignas(BUFFER_ALIGNMENT) double paramValue[nTotalParams][MAX_BUFFER_SIZE];
+	double normalisedValue[nTotalParams] = { 0.0 };
+	double realValue[nTotalParams] = { 0.0 };
+	ParamPointQueue paramPointQueue[nTotalParams];
+	ParamSmoother smoother[nTotalParams];
+
+	// Process-wide read-only tables, held for the lifetime of the processor.
+	const SharedTables* sharedTables = SharedTables::acquire();
+
+	// State from setState, picked up by process at the start of a block.
+	ParameterSnapshot parameterSnapshot;
+	std::mutex stateMutex;
+
+	bool paramIsConstant[nTotalParams] = { false };
+	bool needsSnap = false;
+
+	// Control rate parameters are interpolated from the previous to the current control point.
+	double controlPrevious[nTotalParams] = { 0.0 };
+	double controlCurrent[nTotalParams] = { 0.0 };
 
-	double rectifiedSignal[MAX_BUFFER_SIZE];
-	double filteredInput[2][MAX_BUFFER_SIZE];
-	double amplifiedInput[2][MAX_BUFFER_SIZE];
-	double sideEnvelope[MAX_BUFFER_SIZE];
-	double wetSignal[2][MAX_BUFFER_SIZE];
+	alignas(BUFFER_ALIGNMENT) double rectifiedSignal[MAX_BUFFER_SIZE];
+	alignas(BUFFER_ALIGNMENT) double filteredInput[2][MAX_BUFFER_SIZE];
+	alignas(BUFFER_ALIGNMENT) double amplifiedInput[2][MAX_BUFFER_SIZE];
+	alignas(BUFFER_ALIGNMENT) double sideEnvelope[MAX_BUFFER_SIZE];
+	alignas(BUFFER_ALIGNMENT) double sideThreshold[MAX_BUFFER_SIZE];
+	alignas(BUFFER_ALIGNMENT) double sideRatio[MAX_BUFFER_SIZE];
+	alignas(BUFFER_ALIGNMENT) double wetSignal[2][MAX_BUFFER_SIZE];
 
-	double attackInSamples[MAX_BUFFER_SIZE];
-	double releaseInSamples[MAX_BUFFER_SIZE];
-	double envelopeZ1 = 1.0;
-	double sideEnvelopeZ1 = 1.0;
+	DualEnvelope envelopes;
 
-	// Update rate (in seconds) for the non user parameters.
-	inline static constexpr double updateRate = 0.016667;
-	int updateThreshold = updateRate * 44100.0;
+	Modulation modulation;
+
+	// Update rate (in seconds) for control rate parameters per quality, High updates every sample.
+	inline static constexpr double updateRate[3] = { 0.002, 0.0005, 0.0 };
+	int updateThreshold = updateRate[Normal] * 44100.0;
+
+	// The control grid follows the quality at the start of a block, the rest crossfades per sample.
+	Quality quality = Normal;
+	alignas(BUFFER_ALIGNMENT) double ecoMix[MAX_BUFFER_SIZE];
+	alignas(BUFFER_ALIGNMENT) double highMix[MAX_BUFFER_SIZE];
+	bool ecoActive = false,
+		highActive = false,
+		fullyEco = false,
+		fullyHigh = false;
+
+	// Samples since the last control point at the start of the block.
+	int controlPhase = 0;
+
+	// True peak detection for High.
+	Halfband::Upsampler peakUpsampler[2];
+	alignas(BUFFER_ALIGNMENT) double upsampledInput[2 * MAX_BUFFER_SIZE];
+
+	// Decimated detector, see detectorDecimation. High and analysis run at the full rate.
+	enum DecimatedRow {
+		LevelRow,
+		SideRow,
+		ThresholdRow,
+		RatioRow,
+		KneeRow,
+		SideThresholdRow,
+		SideRatioRow,
+		AttackRow,
+		ReleaseRow,
+		SideAttackRow,
+		SideReleaseRow,
+		EcoRow,
+		NumDecimatedRows
+	};
+
+	int decimation = 1;
+	bool wasDecimated = false;
+	int groupPhase = 0;
+	double groupPeak = 0.0;
+	int groupEnd[MAX_BUFFER_SIZE / 2];
+	alignas(BUFFER_ALIGNMENT) double decimatedRows[NumDecimatedRows][MAX_BUFFER_SIZE / 2];
+
+	// Mid and side envelopes of the last two groups, the full rate ramps between them.
+	double rampFrom[2] = { 1.0, 1.0 },
+		rampTo[2] = { 1.0, 1.0 };
+
+	// Gain reduction history sent to the controller, nullptr until connected.
+	std::unique_ptr<Steinberg::Vst::DataExchangeHandler> dataExchange;
+	GainReductionHistory::Block* historyBlock = nullptr;
+	double historyGainMin = 1.0,
+		historyGainMax = 1.0,
+		historyPeak = 0.0,
+		historyLevelMin = 0.0,
+		historyLevelMax = 0.0;
+	int historySamples = 0;
+
+	// Sent with the history, and read directly by offline harnesses.
+	LoadMeter loadMeter;
 
 	TPTSVF filter[2];
+	SidechainEQ sidechainEQ { *sharedTables };
+
+	// Linear phase crossover, see LinearPhaseCrossover. Its delay is added to the whole signal.
+	bool linearPhase = false;
+	LinearPhaseCrossover linearCrossover;
+	DelayLine wetDelay[2],
+		dryDelay[2];
+	alignas(BUFFER_ALIGNMENT) double delayedSamples[2][MAX_BUFFER_SIZE];
+	void* delayedInput[2] = { delayedSamples[0], delayedSamples[1] };
+
 	Distortion distortion[2];
+
+	// The dry signal with the phase of High's saturation.
+	Halfband::RoundTrip dryRoundTrip[2];
+	alignas(BUFFER_ALIGNMENT) double alignedSamples[2][MAX_BUFFER_SIZE];
+	void* alignedInput[2] = { alignedSamples[0], alignedSamples[1] };
+
+	GainComputer gainComputer;
+	GainComputer sideGainComputer;
 };
 
 //------------------------------------------------------------------------
@@ -0,0 +1,238 @@
+// Hooks for the real-time safety audit, see RealtimeAudit.h. Only active with KWIRE2_RT_AUDIT.
+//
+// operator new and delete are replaced on every platform. malloc and free are caught through the
+// CRT allocation hook on Windows debug builds and by interposing the libc functions elsewhere,
+// along with the pthread locks and the common blocking calls. Win32 locks and system calls can't be
+// interposed without patching the import tables, code on the audio thread can call
+// RealtimeAudit::check for those.
+
+#include "RealtimeAudit.h"
+
+#ifdef KWIRE2_RT_AUDIT
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#include <crtdbg.h>
+#else
+#include <dlfcn.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace RealtimeAudit {
+	namespace {
+		thread_local bool reporting = false;
+	}
+
+	void violation(const char* what)
+	{
+		// The report itself allocates and writes, don't let it recurse.
+		if (reporting)
+			return;
+
+		reporting = true;
+		violationCount.fetch_add(1, std::memory_order_relaxed);
+
+		if (Handler custom = handler.load())
+			custom(what);
+		else
+			fprintf(stderr, "Real-time violation in process(): %s\n", what);
+
+		reporting = false;
+	}
+}
+
+//=========================================
+// C++ allocation
+
+void* operator new(size_t size)
+{
+	RealtimeAudit::check("operator new");
+
+	if (void* p = malloc(size ? size : 1))
+		return p;
+
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	RealtimeAudit::check("operator new");
+
+	const size_t align = size_t(alignment);
+	const size_t rounded = (size + align - 1) / align * align;
+
+#if defined(_WIN32)
+	if (void* p = _aligned_malloc(rounded ? rounded : align, align))
+#else
+	if (void* p = aligned_alloc(align, rounded ? rounded : align))
+#endif
+		return p;
+
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void operator delete(void* p) noexcept
+{
+	if (p)
+		RealtimeAudit::check("operator delete");
+
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	operator delete(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	operator delete(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	operator delete(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+	if (p)
+		RealtimeAudit::check("operator delete");
+
+#if defined(_WIN32)
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+void operator delete[](void* p, std::align_val_t alignment) noexcept
+{
+	operator delete(p, alignment);
+}
+
+void operator delete(void* p, size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(p, alignment);
+}
+
+void operator delete[](void* p, size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(p, alignment);
+}
+
+//=========================================
+// C allocation, locks and blocking calls
+
+#if defined(_WIN32)
+
+#ifdef _DEBUG
+namespace {
+	int allocationHook(int type, void*, size_t, int, long, const unsigned char*, int)
+	{
+		if (type == _HOOK_ALLOC || type == _HOOK_REALLOC)
+			RealtimeAudit::check("malloc");
+		else if (type == _HOOK_FREE)
+			RealtimeAudit::check("free");
+
+		return 1;
+	}
+
+	const _CRT_ALLOC_HOOK previousHook = _CrtSetAllocHook(allocationHook);
+}
+#endif
+
+#else
+
+extern "C" {
+	void* __libc_malloc(size_t);
+	void* __libc_calloc(size_t, size_t);
+	void* __libc_realloc(void*, size_t);
+	void __libc_free(void*);
+
+	void* malloc(size_t size)
+	{
+		RealtimeAudit::check("malloc");
+		return __libc_malloc(size);
+	}
+
+	void* calloc(size_t count, size_t size)
+	{
+		RealtimeAudit::check("calloc");
+		return __libc_calloc(count, size);
+	}
+
+	void* realloc(void* p, size_t size)
+	{
+		RealtimeAudit::check("realloc");
+		return __libc_realloc(p, size);
+	}
+
+	void free(void* p)
+	{
+		if (p)
+			RealtimeAudit::check("free");
+
+		__libc_free(p);
+	}
+}
+
+// Forwards to the next definition of the function, after reporting the call.
+#define KWIRE2_AUDIT_FORWARD(returnType, name, parameters, arguments) \
+	extern "C" returnType name parameters \
+	{ \
+		RealtimeAudit::check(#name); \
+		static auto next = reinterpret_cast<returnType (*) parameters>(dlsym(RTLD_NEXT, #name)); \
+		return next arguments; \
+	}
+
+KWIRE2_AUDIT_FORWARD(int, pthread_mutex_lock, (pthread_mutex_t* mutex), (mutex))
+KWIRE2_AUDIT_FORWARD(int, pthread_cond_wait, (pthread_cond_t* cond, pthread_mutex_t* mutex), (cond, mutex))
+KWIRE2_AUDIT_FORWARD(int, pthread_join, (pthread_t thread, void** result), (thread, result))
+KWIRE2_AUDIT_FORWARD(int, sem_post, (sem_t* semaphore), (semaphore))
+KWIRE2_AUDIT_FORWARD(int, nanosleep, (const struct timespec* duration, struct timespec* remaining), (duration, remaining))
+KWIRE2_AUDIT_FORWARD(int, usleep, (useconds_t microseconds), (microseconds))
+KWIRE2_AUDIT_FORWARD(ssize_t, read, (int fd, void* buffer, size_t count), (fd, buffer, count))
+KWIRE2_AUDIT_FORWARD(ssize_t, write, (int fd, const void* buffer, size_t count), (fd, buffer, count))
+
+#undef KWIRE2_AUDIT_FORWARD
+
+// std::counting_semaphore and atomic wait and notify sleep and wake through futex, which libstdc++
+// calls through syscall. Six arguments is the most any system call takes.
+extern "C" long syscall(long number, ...) noexcept
+{
+	RealtimeAudit::check("syscall");
+
+	long arguments[6];
+	va_list list;
+	va_start(list, number);
+
+	for (long& argument : arguments)
+		argument = va_arg(list, long);
+
+	va_end(list);
+
+	static auto next = reinterpret_cast<long (*)(long, ...)>(dlsym(RTLD_NEXT, "syscall"));
+	return next(number, arguments[0], arguments[1], arguments[2], arguments[3], arguments[4], arguments[5]);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,285 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2025 Laser Brain.
+//------------------------------------------------------------------------
+
+// Builds and searches preset banks, see includes/PresetBank.h.
+//
+//   Kwire2bank --build <bank> <dir>...
+//   Kwire2bank <bank> [--find <text>] [--tag <name>]... [--values]
+//
+// A bank is built from the presets under the directories: .vstpreset files saved by a host, and any
+// other file as a processor state (eg. from Kwire2render --save-preset). A preset is named after its
+// file and tagged with the directories between the given one and the file.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "PresetBank.h"
+
+namespace {
+	struct Options {
+		std::filesystem::path bank;
+		std::vector<std::filesystem::path> directories;
+		bool build = false;
+		std::string find;
+		std::vector<std::string> tags;
+		bool values = false;
+	};
+
+	void printUsage()
+	{
+		printf(
+			"Usage: Kwire2bank --build <bank> <dir>...\n"
+			"       Kwire2bank <bank> [options]\n"
+			"\n"
+			"Options:\n"
+			"  --find <text>   Presets with text in their name, ignoring case\n"
+			"  --tag <name>    Presets with the tag, can be repeated\n"
+			"  --values        Print the parameter values of the presets found\n");
+	}
+
+	bool readFile(const std::filesystem::path& path, std::vector<char>& contents)
+	{
+		std::ifstream file(path, std::ios::binary);
+
+		if (!file)
+			return false;
+
+		contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return true;
+	}
+
+	// Processor state of a .vstpreset, its "Comp" chunk.
+	bool componentState(const std::vector<char>& file, std::vector<char>& state)
+	{
+		// "VST3", the version, the class ID as 32 characters, then the offset of the chunk list.
+		if (file.size() < 48 || std::memcmp(file.data(), "VST3", 4) != 0)
+			return false;
+
+		int64_t listOffset;
+		std::memcpy(&listOffset, file.data() + 40, sizeof(listOffset));
+
+		// "List", the number of chunks, then the ID, offset and size of each.
+		if (listOffset < 48 || uint64_t(listOffset) + 8 > file.size() || std::memcmp(file.data() + listOffset, "List", 4) != 0)
+			return false;
+
+		int32_t count;
+		std::memcpy(&count, file.data() + listOffset + 4, sizeof(count));
+
+		for (int32_t c = 0; c < count && uint64_t(listOffset) + 8 + (c + 1) * 20 <= file.size(); ++c)
+		{
+			const char* chunk = file.data() + listOffset + 8 + c * 20;
+
+			int64_t offset,
+				size;
+			std::memcpy(&offset, chunk + 4, sizeof(offset));
+			std::memcpy(&size, chunk + 12, sizeof(size));
+
+			if (std::memcmp(chunk, "Comp", 4) == 0 && offset >= 0 && size >= 0 && uint64_t(offset + size) <= file.size())
+			{
+				state.assign(file.data() + offset, file.data() + offset + size);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool build(const Options& options)
+	{
+		std::vector<PresetBank::Preset> presets;
+		std::vector<std::filesystem::path> paths;
+
+		for (const std::filesystem::path& directory : options.directories)
+		{
+			std::vector<std::filesystem::path> files;
+			std::error_code error;
+
+			for (const auto& item : std::filesystem::recursive_directory_iterator(directory, error))
+			{
+				if (item.is_regular_file())
+					files.push_back(item.path());
+			}
+
+			if (error)
+			{
+				fprintf(stderr, "Can't read %s\n", directory.string().c_str());
+				return false;
+			}
+
+			std::sort(files.begin(), files.end());
+
+			for (const std::filesystem::path& path : files)
+			{
+				PresetBank::Preset preset;
+				std::vector<char> contents;
+
+				if (!readFile(path, contents))
+				{
+					fprintf(stderr, "Can't read %s\n", path.string().c_str());
+					return false;
+				}
+
+				if (path.extension() == ".vstpreset")
+				{
+					if (!componentState(contents, preset.state))
+					{
+						fprintf(stderr, "Skipping %s, no processor state\n", path.string().c_str());
+						continue;
+					}
+				}
+				else
+				{
+					preset.state = std::move(contents);
+				}
+
+				preset.name = path.stem().string();
+
+				for (const std::filesystem::path& part : path.parent_path().lexically_relative(directory))
+				{
+					if (part != ".")
+						preset.tags.push_back(part.string());
+				}
+
+				presets.push_back(std::move(preset));
+				paths.push_back(path);
+			}
+		}
+
+		std::vector<size_t> rejected;
+		const std::vector<char> bank = PresetBank::build(presets, rejected);
+
+		for (size_t p : rejected)
+			fprintf(stderr, "Skipping %s, not a K-wire 2 state\n", paths[p].string().c_str());
+
+		if (bank.empty())
+		{
+			fprintf(stderr, "More than %d tags\n", PresetBank::MAX_TAGS);
+			return false;
+		}
+
+		std::ofstream file(options.bank, std::ios::binary);
+
+		if (!file.write(bank.data(), std::streamsize(bank.size())))
+		{
+			fprintf(stderr, "Can't write %s\n", options.bank.string().c_str());
+			return false;
+		}
+
+		printf("%s: %zu presets\n", options.bank.string().c_str(), presets.size() - rejected.size());
+		return true;
+	}
+
+	bool search(const Options& options)
+	{
+		PresetBank bank;
+
+		if (!bank.open(options.bank))
+		{
+			fprintf(stderr, "Can't open bank %s\n", options.bank.string().c_str());
+			return false;
+		}
+
+		uint64_t tags = 0;
+
+		for (const std::string& tag : options.tags)
+		{
+			const uint64_t mask = bank.tagMask(tag);
+
+			// No preset can match, the search still runs to show there are none.
+			tags |= mask ? mask : ~uint64_t(0);
+		}
+
+		int found = 0;
+
+		bank.find(options.find, tags, [&](int preset) {
+			std::string tagList;
+
+			for (int t = 0; t < bank.tagCount(); ++t)
+			{
+				if (bank.tags(preset) & (uint64_t(1) << t))
+					tagList += (tagList.empty() ? "" : ", ") + std::string(bank.tagName(t));
+			}
+
+			printf("%4d  %-*.*s  %s\n", preset, PresetBank::NAME_SIZE, int(bank.name(preset).size()), bank.name(preset).data(), tagList.c_str());
+
+			if (options.values)
+			{
+				for (CustomParameter& parameter : customParameters)
+				{
+					printf("        %-20s %.2f %s\n", parameter.title.c_str(),
+						parameter.normalisedToPlain(bank.normalised(preset, parameter.id)), parameter.units.c_str());
+				}
+			}
+
+			++found;
+		});
+
+		printf("%d of %d presets\n", found, bank.size());
+		return true;
+	}
+
+	bool parseArguments(int argc, char* argv[], Options& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string argument = argv[i];
+			const bool hasValue = i + 1 < argc;
+
+			if (argument == "--build" && hasValue)
+			{
+				options.build = true;
+				options.bank = argv[++i];
+			}
+			else if (argument == "--find" && hasValue)
+			{
+				options.find = argv[++i];
+			}
+			else if (argument == "--tag" && hasValue)
+			{
+				options.tags.push_back(argv[++i]);
+			}
+			else if (argument == "--values")
+			{
+				options.values = true;
+			}
+			else if (argument.rfind("--", 0) == 0)
+			{
+				fprintf(stderr, "Unknown option %s\n", argument.c_str());
+				return false;
+			}
+			else if (options.build)
+			{
+				options.directories.push_back(argument);
+			}
+			else if (options.bank.empty())
+			{
+				options.bank = argument;
+			}
+			else
+			{
+				fprintf(stderr, "Unexpected argument %s\n", argument.c_str());
+				return false;
+			}
+		}
+
+		return !options.bank.empty() && (!options.build || !options.directories.empty());
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+
+	if (!parseArguments(argc, argv, options))
+	{
+		printUsage();
+		return 1;
+	}
+
+	return (options.build ? build(options) : search(options)) ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2025 Laser Brain.
+//------------------------------------------------------------------------
+
+// Per-call cost of the controller's parameter display strings.
+//
+//   Kwire2formatbench [--calls N]
+//
+// Times ParameterFormat against the stringstream and stod implementation it replaced, formatting
+// and parsing every parameter over its range, and checks that every formatted value parses back.
+
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#include "public.sdk/source/vst/utility/stringconvert.h"
+
+#include "parameters.h"
+#include "ParameterFormat.h"
+
+using namespace Steinberg;
+using namespace Steinberg::Vst;
+
+namespace {
+	constexpr int VALUES = 101;
+
+	// The previous getParamStringByValue.
+	bool formatWithStream(CustomParameter& param, ParamValue valueNormalized, String128 string)
+	{
+		std::stringstream display;
+		display << std::fixed << std::setprecision(param.stepCount == 0 ? 2 : 0) << param.normalisedToPlain(valueNormalized) << " " << param.units;
+
+		return StringConvert::convert(display.str(), string);
+	}
+
+	// The previous getParamValueByString.
+	bool parseWithStod(CustomParameter& param, const TChar* string, ParamValue& valueNormalized)
+	{
+		std::string str;
+
+		if (!StringConvert::convert(string, str))
+			return false;
+
+		try
+		{
+			valueNormalized = param.plainToNormalised(std::stod(str));
+		}
+		catch (...)
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+	bool formatWithChars(CustomParameter& param, ParamValue valueNormalized, String128 string)
+	{
+		char display[ParameterFormat::BUFFER_SIZE];
+		const int length = ParameterFormat::format(param, param.normalisedToPlain(valueNormalized), display, sizeof(display));
+
+		ParameterFormat::widen(display, length, string);
+		return length > 0;
+	}
+
+	bool parseWithChars(CustomParameter& param, const TChar* string, ParamValue& valueNormalized)
+	{
+		char text[ParameterFormat::BUFFER_SIZE];
+		int length;
+		double plain;
+
+		if (!ParameterFormat::narrow(string, text, sizeof(text), length) || !ParameterFormat::parse(param, text, length, plain))
+			return false;
+
+		valueNormalized = param.plainToNormalised(plain);
+		return true;
+	}
+
+	// Nanoseconds per call of function over every parameter and value, calls times.
+	template <typename Function>
+	double time(int calls, Function&& function)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		int count = 0;
+
+		while (count < calls)
+		{
+			for (int id = 0; id < nParams; ++id)
+			{
+				for (int v = 0; v < VALUES; ++v, ++count)
+					function(customParameters[id], double(v) / double(VALUES - 1));
+			}
+		}
+
+		const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / double(count);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int calls = 1000000;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string argument = argv[i];
+
+		if (argument == "--calls" && i + 1 < argc)
+		{
+			calls = (std::max)(1, atoi(argv[++i]));
+		}
+		else
+		{
+			fprintf(stderr, "Usage: Kwire2formatbench [--calls N]\n");
+			return 1;
+		}
+	}
+
+	// Formatted strings to parse, one per parameter and value.
+	static String128 strings[nParams][VALUES];
+	int mismatches = 0;
+
+	for (int id = 0; id < nParams; ++id)
+	{
+		CustomParameter& param = customParameters[id];
+		const double tolerance = param.stepCount == 0 ? 0.005 : 0.5;
+
+		for (int v = 0; v < VALUES; ++v)
+		{
+			ParamValue parsed = 0.0;
+			formatWithChars(param, double(v) / double(VALUES - 1), strings[id][v]);
+
+			// Every string parses back to the value it shows.
+			if (!parseWithChars(param, strings[id][v], parsed) ||
+				abs(param.normalisedToPlain(parsed) - param.normalisedToPlain(double(v) / double(VALUES - 1))) > tolerance * 1.0001)
+			{
+				std::string display;
+				StringConvert::convert(strings[id][v], display);
+				fprintf(stderr, "%s: \"%s\" doesn't parse back\n", param.title.c_str(), display.c_str());
+				++mismatches;
+			}
+		}
+	}
+
+	const auto stringOf = [](CustomParameter& param, double normalised) -> const TChar* {
+		return strings[param.id][int(lround(normalised * (VALUES - 1)))];
+	};
+
+	String128 output;
+	ParamValue value = 0.0;
+
+	const double streamFormat = time(calls, [&](CustomParameter& param, double normalised) { formatWithStream(param, normalised, output); });
+	const double charsFormat = time(calls, [&](CustomParameter& param, double normalised) { formatWithChars(param, normalised, output); });
+	const double stodParse = time(calls, [&](CustomParameter& param, double normalised) { parseWithStod(param, stringOf(param, normalised), value); });
+	const double charsParse = time(calls, [&](CustomParameter& param, double normalised) { parseWithChars(param, stringOf(param, normalised), value); });
+
+	printf("format  stringstream %8.1f ns   to_chars   %8.1f ns   %.1fx\n", streamFormat, charsFormat, streamFormat / charsFormat);
+	printf("parse   stod         %8.1f ns   from_chars %8.1f ns   %.1fx\n", stodParse, charsParse, stodParse / charsParse);
+
+	if (mismatches)
+		printf("%d values don't parse back\n", mismatches);
+
+	return mismatches ? 2 : 0;
+}
@@ -0,0 +1,538 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2025 Laser Brain.
+//------------------------------------------------------------------------
+
+// Differential check of the processor against a frozen reference of its chain (ReferenceChain.h).
+//
+//   Kwire2oracle [--sets N] [--seconds S] [--quality eco | normal] [--crossover minimum | linear]
+//                [--automation P] [--seed N]
+//
+// Every parameter set is fuzzed (parameters, modulation, sample rate, input level) and run in float
+// and in double, through random block sizes with random automation points. Each stage of the processor
+// is compared with the reference sample by sample, and the worst deviation of every stage is reported
+// against its tolerance. Automation points have to land on their offsets, and a state loaded during a
+// block, followed by a latency parameter message, has to reach the processor whole. Exits with code 2
+// if a stage is out of tolerance, a point is missed or the state is lost.
+//
+// The linear phase crossover is checked against a direct FIR of its kernel. Its cutoff stays where the
+// set puts it, neither automated nor modulated, as the convolver takes up a new kernel within a
+// partition. Its sets run at up to 96 kHz, the direct FIR costs the whole kernel per sample.
+//
+// High isn't checked: it oversamples the saturation and detects peaks between samples, which
+// the reference doesn't model.
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "base/source/fstreamer.h"
+
+#include "OfflineProcessor.h"
+#include "ParameterChanges.h"
+#include "ReferenceChain.h"
+
+using namespace Steinberg;
+using namespace Steinberg::Vst;
+
+namespace {
+	struct Options {
+		int sets = 50;
+		double seconds = 1.0;
+		Quality quality = Normal;
+		CrossoverPhase crossover = MinimumPhase;
+		double automation = 0.3;
+		unsigned seed = 1;
+	};
+
+	// Exposes the buffers each stage leaves behind after process.
+	class ProbedProcessor : public Kwire2::Kwire2Processor {
+	public:
+		using Kwire2Processor::paramValue;
+		using Kwire2Processor::normalisedValue;
+		using Kwire2Processor::realValue;
+		using Kwire2Processor::paramIsConstant;
+		using Kwire2Processor::amplifiedInput;
+		using Kwire2Processor::filteredInput;
+		using Kwire2Processor::rectifiedSignal;
+		using Kwire2Processor::sideEnvelope;
+		using Kwire2Processor::wetSignal;
+		using Kwire2Processor::controlPhase;
+		using Kwire2Processor::updateThreshold;
+		using Kwire2Processor::requestedPartition;
+		using Kwire2Processor::setLatencyParameter;
+		using Kwire2Processor::endBlock;
+	};
+
+	enum Stage {
+		Saturation,
+		Crossover,
+		MidGain,
+		SideGain,
+		Wet,
+		Output,
+		NumStages
+	};
+
+	enum Unit {
+		Ulp,	// Units in the last place of the reference, in double.
+		Decibel,	// Ratio of the gains.
+		Relative	// Difference relative to full scale, or to the reference's level when it's louder.
+	};
+
+	struct StageInfo {
+		const char* name;
+		Unit unit;
+		double tolerance[2]; // Normal, Eco.
+	};
+
+	// Normal's gain table is within 0.1 dB of the curve, at a hard knee. Eco's approximate log and exp are each
+	// within 0.0861 octave (0.518 dB), the ratio scales the first: (2 + 1) * 0.518 = 1.555 dB at the largest
+	// ratio, and (4 + 1) * 0.518 = 2.591 dB at the side's doubled ratio, with 0.05 dB of margin. The stages
+	// after the gain follow.
+	const StageInfo stageInfo[NumStages] = {
+		{ "saturation", Ulp, { 64.0, 64.0 } },
+		{ "crossover", Relative, { -200.0, -200.0 } },
+		{ "mid gain", Decibel, { 0.1, 1.6 } },
+		{ "side gain", Decibel, { 0.1, 2.65 } },
+		{ "wet", Relative, { -50.0, -10.0 } },
+		{ "output", Relative, { -50.0, -10.0 } },
+	};
+
+	const char* unitNames[] = { "ulp", "dB", "dBr" };
+
+	struct Worst {
+		double value = -DBL_MAX;
+		std::string where;
+	};
+
+	// level is the reference's level for Relative.
+	double deviation(Unit unit, double processed, double reference, double level)
+	{
+		switch (unit)
+		{
+		case Ulp:
+		{
+			const double spacing = (std::max)(std::nextafter(std::abs(reference), DBL_MAX) - std::abs(reference), DBL_MIN);
+			return std::abs(processed - reference) / spacing;
+		}
+		case Decibel:
+			return std::abs(20.0 * std::log10((std::max)(processed, 1e-30) / (std::max)(reference, 1e-30)));
+		default:
+			return 20.0 * std::log10((std::max)(std::abs(processed - reference) / (std::max)(1.0, level), 1e-30));
+		}
+	}
+
+	// Sum of two sines and noise under a level that jumps every 50 to 200 ms, so the detector
+	// keeps attacking and releasing.
+	class Signal {
+	public:
+		Signal(double sampleRate, std::minstd_rand& random) :
+			sampleRate(sampleRate)
+		{
+			std::uniform_real_distribution<double> frequency(20.0, 0.45 * sampleRate);
+
+			for (double& f : increment)
+				f = 2.0 * M_PI * frequency(random) / sampleRate;
+
+			peak = std::uniform_real_distribution<double>(-30.0, 12.0)(random);
+		}
+
+		void generate(double* const* output, int samples, std::minstd_rand& random)
+		{
+			std::uniform_real_distribution<double> unit(-1.0, 1.0);
+
+			for (int s = 0; s < samples; ++s)
+			{
+				if (--hold <= 0)
+				{
+					hold = int(sampleRate * (0.05 + 0.075 * (unit(random) + 1.0)));
+					level = dbtoa(peak - 20.0 * (unit(random) + 1.0));
+				}
+
+				for (int i = 0; i < 2; ++i)
+					phase[i] = std::fmod(phase[i] + increment[i], 2.0 * M_PI);
+
+				const double tone = 0.4 * std::sin(phase[0]) + 0.3 * std::sin(phase[1]);
+
+				for (int c = 0; c < 2; ++c)
+					output[c][s] = level * (tone * (c == 0 ? 1.0 : 0.7) + 0.3 * unit(random));
+			}
+		}
+
+	private:
+		double sampleRate;
+		double increment[2] = {};
+		double phase[2] = {};
+		double peak = 0.0;
+		double level = 0.0;
+		int hold = 0;
+	};
+
+	// Normalised value, at either end of the range one time in five.
+	double fuzzedValue(std::minstd_rand& random)
+	{
+		const int draw = int(random() % 10);
+
+		if (draw < 2)
+			return double(draw);
+
+		return std::uniform_real_distribution<double>(0.0, 1.0)(random);
+	}
+
+	int blockSize(std::minstd_rand& random)
+	{
+		static constexpr int common[] = { 1, 2, 3, 16, 64, 100, 128, 256, 333, 512, 1024, MAX_BUFFER_SIZE };
+
+		if (random() % 2)
+			return common[random() % std::size(common)];
+
+		return 1 + int(random() % MAX_BUFFER_SIZE);
+	}
+
+	bool isModDestination(ParamID id)
+	{
+		return id >= mod1DestinationId && id < nInternalEnd && (id - mod1DestinationId) % MOD_SLOT_PARAMS == 0;
+	}
+
+	// State in the processor's format with every parameter fuzzed, bypass off, the quality and the
+	// crossover under test. A linear phase crossover isn't a modulation destination.
+	std::vector<char> fuzzedState(Quality quality, CrossoverPhase crossover, std::minstd_rand& random)
+	{
+		MemoryStream stream;
+		IBStreamer streamer(&stream, kLittleEndian);
+
+		for (CustomParameter& parameter : customParameters)
+		{
+			double normalised = fuzzedValue(random);
+
+			if (parameter.id == bypassId)
+				normalised = 0.0;
+			else if (parameter.id == qualityId)
+				normalised = parameter.plainToNormalised(double(quality));
+			else if (parameter.id == crossoverPhaseId)
+				normalised = parameter.plainToNormalised(double(crossover));
+			else if (crossover == LinearPhase && isModDestination(parameter.id) && std::lround(parameter.normalisedToPlain(normalised)) == 0)
+				normalised = parameter.plainToNormalised(1.0);
+
+			streamer.writeStr8(parameter.title.c_str());
+			streamer.writeDouble(parameter.normalisedToPlain(normalised));
+		}
+
+		return std::vector<char>(stream.getData(), stream.getData() + stream.getSize());
+	}
+
+	// A few parameters, bypass included, get one to four points in the block. A linear phase crossover
+	// keeps its kernel.
+	void fuzzAutomation(ParamChanges& changes, int samples, double automation, bool linear, std::minstd_rand& random)
+	{
+		std::uniform_real_distribution<double> unit(0.0, 1.0);
+		changes.count = 0;
+
+		if (unit(random) >= automation)
+			return;
+
+		const int parameters = 1 + int(random() % 3);
+
+		for (int i = 0; i < parameters; ++i)
+		{
+			const ParamID id = ParamID(random() % nTotalParams);
+			int32 index;
+
+			if (id == qualityId || paramChangesLatency(id))
+				continue;
+
+			if (linear && (id == crossoverId || isModDestination(id)))
+				continue;
+
+			IParamValueQueue* queue = changes.addParameterData(id, index);
+			const int points = 1 + int(random() % ParamQueue::MAX_POINTS);
+			int32 offset = 0;
+
+			// Bypass is a toggle, hosts send it 0 or 1.
+			for (int p = 0; p < points && queue; ++p)
+			{
+				offset = offset + int32(random() % (samples - offset));
+				queue->addPoint(offset, id == bypassId ? double(random() % 2) : fuzzedValue(random), index);
+			}
+		}
+	}
+
+	template <typename SampleType>
+	void runSet(int set, const Options& options, Worst (&worst)[NumStages])
+	{
+		static constexpr double sampleRates[] = { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+		static constexpr int linearRates = 4;
+		static double input[2][MAX_BUFFER_SIZE];
+		static SampleType hostInput[2][MAX_BUFFER_SIZE];
+		static SampleType hostOutput[2][MAX_BUFFER_SIZE];
+		static ReferenceChain::Stages reference;
+
+		// Float and double runs of a set see the same parameters, blocks and input.
+		std::minstd_rand random(options.seed * 7919u + unsigned(set));
+		const bool linear = options.crossover == LinearPhase;
+		const double sampleRate = sampleRates[random() % (linear ? linearRates : std::size(sampleRates))];
+		const bool doublePrecision = std::is_same_v<SampleType, double>;
+
+		ProbedProcessor* probe = new ProbedProcessor();
+		OfflineProcessor processor(sampleRate, doublePrecision, true, probe);
+		processor.setState(fuzzedState(options.quality, options.crossover, random));
+
+		ReferenceChain chain(sampleRate, Kwire2::Kwire2Processor::detectorDecimation(sampleRate), probe->requestedPartition());
+		Signal signal(sampleRate, random);
+		ParamChanges changes;
+
+		double* inputRows[2] = { input[0], input[1] };
+		SampleType* in[2] = { hostInput[0], hostInput[1] };
+		SampleType* out[2] = { hostOutput[0], hostOutput[1] };
+
+		const int64_t length = int64_t(options.seconds * sampleRate);
+
+		for (int64_t position = 0, block = 0; position < length; ++block)
+		{
+			const int samples = int((std::min)(int64_t(blockSize(random)), length - position));
+
+			signal.generate(inputRows, samples, random);
+			fuzzAutomation(changes, samples, options.automation, linear, random);
+
+			// The reference reads the input as the processor does, after conversion to SampleType.
+			for (int c = 0; c < 2; ++c)
+			{
+				for (int s = 0; s < samples; ++s)
+				{
+					hostInput[c][s] = static_cast<SampleType>(input[c][s]);
+					input[c][s] = static_cast<double>(hostInput[c][s]);
+				}
+			}
+
+			processor.process(in, out, samples, &changes);
+
+			const bool bypassed = probe->paramIsConstant[bypassId] && probe->realValue[bypassId] == 1.0;
+			const int interval = probe->updateThreshold;
+			const int phase = ((probe->controlPhase - samples) % interval + interval) % interval;
+
+			// A running detector carries on through the bypassed block, the reference runs the whole chain
+			// and its output is the input all the same. The linear phase detector always runs.
+			const bool detectorPaused = std::lround(probe->realValue[bypassDetectorId]) == DetectorPaused;
+
+			chain.process(inputRows, samples, probe->paramValue, phase, interval, bypassed && detectorPaused && !linear, reference);
+
+			// After the gains, the level is the one they act on (see ReferenceChain::Stages).
+			const auto compare = [&](Stage stage, int channel, const double* processed, const double* expected, const double* gainLevel = nullptr) {
+				for (int s = 0; s < samples; ++s)
+				{
+					const double level = gainLevel ? (std::max)(std::abs(expected[s]), gainLevel[s]) : std::abs(expected[s]);
+					const double value = deviation(stageInfo[stage].unit, processed[s], expected[s], level);
+
+					if (!(value <= worst[stage].value))
+					{
+						char where[160];
+						snprintf(where, sizeof(where), "set %d %s %.0f Hz, block %lld (%d samples), channel %d sample %d",
+							set, doublePrecision ? "double" : "float", sampleRate, (long long)block, samples, channel, s);
+
+						worst[stage].value = std::isnan(value) ? DBL_MAX : value;
+						worst[stage].where = where;
+					}
+				}
+			};
+
+			if (!bypassed)
+			{
+				for (int c = 0; c < 2; ++c)
+				{
+					compare(Saturation, c, probe->amplifiedInput[c], reference.saturated[c]);
+					compare(Crossover, c, probe->filteredInput[c], reference.filtered[c]);
+					compare(Wet, c, probe->wetSignal[c], reference.wet[c], reference.wetLevel);
+				}
+
+				compare(MidGain, 0, probe->rectifiedSignal, reference.midGain);
+				compare(SideGain, 0, probe->sideEnvelope, reference.sideGain);
+			}
+
+			// Output as the host sees it, the reference rounded to SampleType.
+			for (int c = 0; c < 2; ++c)
+			{
+				double processed[MAX_BUFFER_SIZE];
+				double expected[MAX_BUFFER_SIZE];
+
+				for (int s = 0; s < samples; ++s)
+				{
+					processed[s] = static_cast<double>(hostOutput[c][s]);
+					expected[s] = static_cast<double>(static_cast<SampleType>(reference.output[c][s]));
+				}
+
+				compare(Output, c, processed, expected, bypassed ? nullptr : reference.outputLevel);
+			}
+
+			position += samples;
+		}
+
+	}
+
+	// Automation of a continuous parameter at the first, a middle and the last sample of a block. The
+	// value at each point's offset is the point's. Returns what differs, empty if nothing does.
+	std::string checkPointOffsets()
+	{
+		static float silence[2][MAX_BUFFER_SIZE];
+		float* io[2] = { silence[0], silence[1] };
+		const int samples = 256;
+		const struct {
+			int32 offset;
+			double value;
+		} points[] = { { 0, 0.2 }, { samples / 2, 0.7 }, { samples - 1, 0.4 } };
+
+		ProbedProcessor* probe = new ProbedProcessor();
+		OfflineProcessor processor(48000.0, false, true, probe);
+		ParamChanges changes;
+		int32 index;
+
+		processor.process(io, io, samples);
+
+		IParamValueQueue* queue = changes.addParameterData(mixId, index);
+
+		for (const auto& [offset, value] : points)
+			queue->addPoint(offset, value, index);
+
+		processor.process(io, io, samples, &changes);
+
+		for (const auto& [offset, value] : points)
+		{
+			const double expected = customParameters[mixId].normalisedToReal(value);
+
+			if (probe->paramValue[mixId][offset] != expected)
+			{
+				char what[160];
+				snprintf(what, sizeof(what), "Mix is %g at offset %d, not %g", probe->paramValue[mixId][offset], int(offset), expected);
+
+				return what;
+			}
+		}
+
+		return {};
+	}
+
+	// A host loading a project while audio runs: setState comes in during a block, the block ends and
+	// records its values, then the controller takes up the state and sends a latency parameter. The
+	// processor and getState have to end up with the state's values and the message's. Returns what
+	// differs, empty if nothing does.
+	std::string checkStateHandoff(unsigned seed)
+	{
+		static float silence[2][MAX_BUFFER_SIZE];
+		float* io[2] = { silence[0], silence[1] };
+
+		std::minstd_rand random(seed);
+		ProbedProcessor* probe = new ProbedProcessor();
+		OfflineProcessor processor(48000.0, false, true, probe);
+
+		processor.process(io, io, MAX_BUFFER_SIZE);
+
+		// Minimum phase, the partition doesn't restart processing.
+		std::vector<double> expected(nTotalParams);
+		MemoryStream stream;
+		IBStreamer streamer(&stream, kLittleEndian);
+
+		for (CustomParameter& parameter : customParameters)
+		{
+			double plain = parameter.normalisedToPlain(fuzzedValue(random));
+
+			if (parameter.id == crossoverPhaseId)
+				plain = double(MinimumPhase);
+
+			expected[parameter.id] = parameter.plainToNormalised(plain);
+			streamer.writeStr8(parameter.title.c_str());
+			streamer.writeDouble(plain);
+		}
+
+		processor.setState(std::vector<char>(stream.getData(), stream.getData() + stream.getSize()));
+		probe->endBlock(0);
+
+		const double partition = customParameters[crossoverPartitionId].plainToNormalised(double(random() % 6));
+		probe->setLatencyParameter(crossoverPartitionId, partition);
+		expected[crossoverPartitionId] = partition;
+
+		processor.process(io, io, MAX_BUFFER_SIZE);
+
+		for (CustomParameter& parameter : customParameters)
+		{
+			const double stored = parameter.plainToNormalised(processor.plainValue(parameter.id));
+
+			if (std::abs(probe->normalisedValue[parameter.id] - expected[parameter.id]) > 1e-9 || std::abs(stored - expected[parameter.id]) > 1e-9)
+			{
+				char what[160];
+				snprintf(what, sizeof(what), "%s is %g, getState %g, not %g", parameter.title.c_str(),
+					probe->normalisedValue[parameter.id], stored, expected[parameter.id]);
+
+				return what;
+			}
+		}
+
+		return {};
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string argument = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (argument == "--sets" && hasValue)
+			options.sets = (std::max)(1, atoi(argv[++i]));
+		else if (argument == "--seconds" && hasValue)
+			options.seconds = (std::max)(0.01, atof(argv[++i]));
+		else if (argument == "--automation" && hasValue)
+			options.automation = std::clamp(atof(argv[++i]), 0.0, 1.0);
+		else if (argument == "--seed" && hasValue)
+			options.seed = unsigned(atoi(argv[++i]));
+		else if (argument == "--quality" && hasValue && (std::string(argv[i + 1]) == "eco" || std::string(argv[i + 1]) == "normal"))
+			options.quality = std::string(argv[++i]) == "eco" ? Eco : Normal;
+		else if (argument == "--crossover" && hasValue && (std::string(argv[i + 1]) == "minimum" || std::string(argv[i + 1]) == "linear"))
+			options.crossover = std::string(argv[++i]) == "linear" ? LinearPhase : MinimumPhase;
+		else
+		{
+			fprintf(stderr, "Usage: Kwire2oracle [--sets N] [--seconds S] [--quality eco | normal] [--crossover minimum | linear]\n"
+				"                    [--automation P] [--seed N]\n");
+			return 1;
+		}
+	}
+
+	const std::string offsets = checkPointOffsets();
+	const std::string handoff = checkStateHandoff(options.seed);
+	Worst worst[NumStages];
+
+	for (int set = 0; set < options.sets; ++set)
+	{
+		runSet<float>(set, options, worst);
+		runSet<double>(set, options, worst);
+	}
+
+	const int tier = options.quality == Eco ? 1 : 0;
+	bool failed = false;
+
+	printf("%-11s %14s %14s   worst at\n", "stage", "worst", "tolerance");
+
+	for (int stage = 0; stage < NumStages; ++stage)
+	{
+		const StageInfo& info = stageInfo[stage];
+		const bool out = worst[stage].value > info.tolerance[tier];
+
+		printf("%-11s %9.4g %-4s %9.4g %-4s %s %s\n", info.name, worst[stage].value, unitNames[info.unit],
+			info.tolerance[tier], unitNames[info.unit], out ? "FAIL" : "  ", worst[stage].where.c_str());
+
+		failed |= out;
+	}
+
+	printf("%-11s %s %s\n", "points", offsets.empty() ? "on their offsets" : "FAIL", offsets.c_str());
+	failed |= !offsets.empty();
+
+	printf("%-11s %s %s\n", "state", handoff.empty() ? "handed over" : "FAIL", handoff.c_str());
+	failed |= !handoff.empty();
+
+	return failed ? 2 : 0;
+}
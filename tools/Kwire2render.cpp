@@ -0,0 +1,787 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2025 Laser Brain.
+//------------------------------------------------------------------------
+
+// Offline renderer, runs the K-wire 2 processor over WAV and RF64 files.
+//
+//   Kwire2render [options] <input.wav> <output.wav>
+//   Kwire2render [options] --out-dir <dir> <input.wav | dir>...
+//   Kwire2render [options] --analyse <input.wav | dir>...
+//
+// Files are streamed through memory-mapped windows and a directory is rendered on a pool of workers.
+// With --split every file is rendered as segments on all the workers instead, for long files.
+
+#include <atomic>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/source/fstreamer.h"
+
+#include "ParameterFormat.h"
+#include "WavFile.h"
+#include "OfflineProcessor.h"
+
+namespace {
+	struct Options {
+		std::vector<char> preset;
+		std::vector<std::pair<std::string, double>> overrides;
+		WavFormat::Encoding encoding = WavFormat::Unsupported; // Same as the input.
+		int blockSize = 1024;
+		int jobs = 0;
+		bool doublePrecision = false;
+		bool realtime = false;
+		bool split = false;
+		double preroll = 0.0; // Seconds, 0 to derive it from the settings.
+		bool verify = false;
+		bool analyse = false;
+		bool histogram = false;
+		std::filesystem::path outDir;
+		std::filesystem::path savePreset;
+		std::vector<std::filesystem::path> inputs;
+	};
+
+	struct Job {
+		std::filesystem::path input;
+		std::filesystem::path output;
+	};
+
+	// Opens the input and checks it can be processed.
+	bool openInput(WavReader& reader, const Job& job, std::string& error)
+	{
+		if (!reader.open(job.input))
+		{
+			error = "can't read, or unsupported format";
+			return false;
+		}
+
+		if (reader.format.channels > 2)
+		{
+			error = "only mono and stereo files are supported";
+			return false;
+		}
+
+		return true;
+	}
+
+	void printUsage()
+	{
+		printf(
+			"Usage: Kwire2render [options] <input.wav> <output.wav>\n"
+			"       Kwire2render [options] --out-dir <dir> <input.wav | dir>...\n"
+			"       Kwire2render [options] --analyse <input.wav | dir>...\n"
+			"\n"
+			"Options:\n"
+			"  --preset <file>        Processor state, as saved by the plug-in or --save-preset\n"
+			"  --set <Title>=<value>  Parameter value as the plug-in displays it, eg. --set Threshold=-18 or --set \"Crossover Phase=Linear\"\n"
+			"  --save-preset <file>   Write the resulting state to a file\n"
+			"  --format 16|24|32f     Output format, defaults to the input format\n"
+			"  --block <samples>      Block size, up to %d\n"
+			"  --jobs <n>             Number of files rendered in parallel\n"
+			"  --split                Render each file as segments on --jobs workers, for long files\n"
+			"  --preroll <seconds>    Processing before each segment, defaults to 12 times the slowest time constant\n"
+			"  --verify               With --split, also render serially and print the largest difference\n"
+			"  --double               Process in 64 bit\n"
+			"  --realtime             Process as in realtime, following Quality whatever Offline Quality says\n"
+			"  --analyse              Only run the detector and print gain reduction statistics\n"
+			"  --histogram            Print the gain reduction histogram with --analyse\n", MAX_BUFFER_SIZE);
+	}
+
+	// NaN or Inf in the input, or reaching the processor's state, see SignalGuard.
+	void reportFaults(const Job& job, OfflineProcessor& processor)
+	{
+		const SignalGuard::Counters& faults = processor.processor->faults();
+
+		if (faults.inputs > 0 || faults.outputs > 0 || faults.states > 0)
+		{
+			fprintf(stderr, "%s: repaired %u input and %u output blocks, cleared the state %u times\n", job.input.string().c_str(),
+				faults.inputs.load(), faults.outputs.load(), faults.states.load());
+		}
+	}
+
+	// The whole of text is a number.
+	template <typename T>
+	bool parseNumber(const char* text, T& value)
+	{
+		const char* last = text + strlen(text);
+		const std::from_chars_result result = std::from_chars(text, last, value);
+
+		return result.ec == std::errc() && result.ptr == last;
+	}
+
+	bool readFile(const std::filesystem::path& path, std::vector<char>& contents)
+	{
+		std::ifstream file(path, std::ios::binary);
+
+		if (!file)
+			return false;
+
+		contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return true;
+	}
+
+	// Parameter values in the getState format: title, then the plain value as a double.
+	std::vector<char> parameterState(const std::vector<std::pair<std::string, double>>& values)
+	{
+		Steinberg::MemoryStream stream;
+		Steinberg::IBStreamer streamer(&stream, kLittleEndian);
+
+		for (const auto& [title, value] : values)
+		{
+			streamer.writeStr8(title.c_str());
+			streamer.writeDouble(value);
+		}
+
+		return std::vector<char>(stream.getData(), stream.getData() + stream.getSize());
+	}
+
+	void applyOptions(OfflineProcessor& processor, const Options& options)
+	{
+		if (!options.preset.empty())
+			processor.setState(options.preset);
+
+		if (!options.overrides.empty())
+			processor.setState(parameterState(options.overrides));
+	}
+
+	// Reads a block, silence past the end of the file. Mono files go through both channels.
+	template <typename SampleType>
+	bool readBlock(WavReader& reader, uint64_t frame, int samples, SampleType* const* in)
+	{
+		const int available = frame < reader.frames ? int((std::min)(uint64_t(samples), reader.frames - frame)) : 0;
+
+		if (available > 0 && !reader.read(frame, available, in))
+			return false;
+
+		for (int c = 0; c < 2; ++c)
+			std::fill(in[c] + available, in[c] + samples, SampleType(0));
+
+		if (reader.format.channels == 1)
+			std::copy(in[0], in[0] + samples, in[1]);
+
+		return true;
+	}
+
+	WavFormat outputFormatFor(const WavFormat& inputFormat, const Options& options)
+	{
+		WavFormat outputFormat = inputFormat;
+		outputFormat.encoding = options.encoding;
+
+		if (outputFormat.encoding == WavFormat::Unsupported)
+		{
+			const WavFormat::Encoding input = inputFormat.encoding;
+			outputFormat.encoding = input == WavFormat::Int16 || input == WavFormat::Int24 ? input : WavFormat::Float32;
+		}
+
+		return outputFormat;
+	}
+
+	template <typename SampleType>
+	bool render(const Job& job, const Options& options, std::string& error)
+	{
+		WavReader reader;
+
+		if (!openInput(reader, job, error))
+			return false;
+
+		const WavFormat outputFormat = outputFormatFor(reader.format, options);
+
+		WavWriter writer;
+
+		if (!writer.open(job.output, outputFormat, reader.frames))
+		{
+			error = "can't create output file";
+			return false;
+		}
+
+		OfflineProcessor processor(reader.format.sampleRate, options.doublePrecision, options.realtime);
+		applyOptions(processor, options);
+
+		std::vector<SampleType> buffer(4 * size_t(options.blockSize));
+		SampleType* in[2] = { buffer.data(), buffer.data() + options.blockSize };
+		SampleType* out[2] = { buffer.data() + 2 * options.blockSize, buffer.data() + 3 * options.blockSize };
+
+		// The output lags by the latency, processing runs that far past the end and drops as much at the start.
+		const uint64_t latency = uint64_t(processor.latency());
+		const uint64_t end = reader.frames + latency;
+
+		for (uint64_t frame = 0; frame < end; frame += options.blockSize)
+		{
+			const int samples = int((std::min)(uint64_t(options.blockSize), end - frame));
+
+			if (!readBlock(reader, frame, samples, in))
+			{
+				error = "read error";
+				return false;
+			}
+
+			processor.process(in, out, samples);
+
+			if (frame + samples <= latency)
+				continue;
+
+			const int skip = latency > frame ? int(latency - frame) : 0;
+			const SampleType* aligned[2] = { out[0] + skip, out[1] + skip };
+
+			if (!writer.write(frame + skip - latency, samples - skip, aligned))
+			{
+				error = "write error";
+				return false;
+			}
+		}
+
+		reportFaults(job, processor);
+		return true;
+	}
+
+	// Processing before a segment for the state left from its start to fade out: 12 time constants
+	// (-104 dB) of the slowest one-pole follower. Those are the saturation drive (113 ms), the
+	// release, the side envelope at its multiple of the release and the modulation follower. Returns a negative
+	// value when an LFO modulates, its phase depends on everything before the segment.
+	double prerollSeconds(OfflineProcessor& processor)
+	{
+		const double release = processor.plainValue(releaseId) * 0.001;
+		double slowest = (std::max)(0.113, release * (std::max)(1.0, processor.plainValue(sideReleaseId)));
+
+		for (int slot = 0; slot < Modulation::SLOTS; ++slot)
+		{
+			const ParamID offset = slot * MOD_SLOT_PARAMS;
+			const int source = int(lround(processor.plainValue(mod1SourceId + offset)));
+
+			if (source == Modulation::Lfo)
+				return -1.0;
+
+			if (source == Modulation::Follower)
+				slowest = (std::max)(slowest, processor.plainValue(followerReleaseId) * 0.001);
+		}
+
+		return 12.0 * slowest;
+	}
+
+	// Renders frames [first, last) of a split file, processing from start. Only the segment's frames are written.
+	template <typename SampleType>
+	bool renderSegment(const Job& job, const Options& options, const WavFormat& outputFormat, uint64_t frames,
+		uint64_t start, uint64_t first, uint64_t last, std::string& error)
+	{
+		WavReader reader;
+		WavWriter writer;
+
+		if (!openInput(reader, job, error))
+			return false;
+
+		if (!writer.attach(job.output, outputFormat, frames))
+		{
+			error = "can't open output file";
+			return false;
+		}
+
+		OfflineProcessor processor(reader.format.sampleRate, options.doublePrecision, options.realtime);
+		applyOptions(processor, options);
+
+		std::vector<SampleType> buffer(4 * size_t(options.blockSize));
+		SampleType* in[2] = { buffer.data(), buffer.data() + options.blockSize };
+		SampleType* out[2] = { buffer.data() + 2 * options.blockSize, buffer.data() + 3 * options.blockSize };
+
+		// Output frame t comes out latency frames after input frame t, as in render.
+		const uint64_t latency = uint64_t(processor.latency());
+		const uint64_t end = last + latency;
+
+		for (uint64_t frame = start; frame < end; frame += options.blockSize)
+		{
+			const int samples = int((std::min)(uint64_t(options.blockSize), end - frame));
+
+			if (!readBlock(reader, frame, samples, in))
+			{
+				error = "read error";
+				return false;
+			}
+
+			processor.process(in, out, samples);
+
+			if (frame + samples <= first + latency)
+				continue;
+
+			// The pre-roll's output is dropped.
+			const int skip = first + latency > frame ? int(first + latency - frame) : 0;
+			const SampleType* segment[2] = { out[0] + skip, out[1] + skip };
+
+			if (!writer.write(frame + skip - latency, samples - skip, segment))
+			{
+				error = "write error";
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Renders one file as segments on several workers. A segment starts processing a pre-roll early,
+	// on the control grid, and by its first frame its followers have forgotten the state they started
+	// from: the segments join without a crossfade.
+	template <typename SampleType>
+	bool renderSplit(const Job& job, const Options& options, int workers, std::string& error)
+	{
+		// Short enough segments would spend most of their time in pre-roll.
+		constexpr double MIN_SEGMENT_SECONDS = 10.0;
+
+		WavReader reader;
+
+		if (!openInput(reader, job, error))
+			return false;
+
+		const double sampleRate = reader.format.sampleRate;
+		const WavFormat outputFormat = outputFormatFor(reader.format, options);
+
+		OfflineProcessor settings(sampleRate, options.doublePrecision, options.realtime);
+		applyOptions(settings, options);
+
+		const double preroll = options.preroll > 0.0 ? options.preroll : prerollSeconds(settings);
+
+		if (preroll < 0.0)
+		{
+			fprintf(stderr, "%s: an LFO modulates, rendering in one piece\n", job.input.string().c_str());
+			return render<SampleType>(job, options, error);
+		}
+
+		WavWriter writer;
+
+		if (!writer.open(job.output, outputFormat, reader.frames))
+		{
+			error = "can't create output file";
+			return false;
+		}
+
+		const uint64_t prerollFrames = uint64_t(ceil(preroll * sampleRate));
+		const uint64_t alignment = uint64_t(Kwire2::Kwire2Processor::controlAlignment(sampleRate));
+		const uint64_t minimum = (std::max)(uint64_t(MIN_SEGMENT_SECONDS * sampleRate), 2 * prerollFrames);
+		const int segments = int(std::clamp(reader.frames / minimum, uint64_t(1), uint64_t(workers)));
+
+		std::vector<std::string> errors(segments);
+		std::vector<std::thread> threads;
+
+		for (int k = 0; k < segments; ++k)
+		{
+			const uint64_t first = reader.frames * k / segments;
+			const uint64_t last = reader.frames * (k + 1) / segments;
+			uint64_t start = first > prerollFrames ? first - prerollFrames : 0;
+			start -= start % alignment;
+
+			threads.emplace_back([&, k, start, first, last]() {
+				renderSegment<SampleType>(job, options, outputFormat, reader.frames, start, first, last, errors[k]);
+			});
+		}
+
+		for (std::thread& thread : threads)
+			thread.join();
+
+		for (const std::string& segmentError : errors)
+		{
+			if (!segmentError.empty())
+			{
+				error = segmentError;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Renders job serially next to its split output and reports the largest difference, in dB relative to full scale.
+	template <typename SampleType>
+	bool verifySplit(const Job& job, const Options& options, std::string& error)
+	{
+		Job serial = job;
+		serial.output += ".serial.wav";
+
+		if (!render<SampleType>(serial, options, error))
+			return false;
+
+		WavReader split;
+		WavReader reference;
+
+		if (!split.open(job.output) || !reference.open(serial.output) || split.frames != reference.frames)
+		{
+			error = "can't read the renders back";
+			return false;
+		}
+
+		std::vector<double> buffer(4 * size_t(options.blockSize));
+		double* a[2] = { buffer.data(), buffer.data() + options.blockSize };
+		double* b[2] = { buffer.data() + 2 * options.blockSize, buffer.data() + 3 * options.blockSize };
+
+		double largest = 0.0;
+		uint64_t at = 0;
+
+		for (uint64_t frame = 0; frame < split.frames; frame += options.blockSize)
+		{
+			const int samples = int((std::min)(uint64_t(options.blockSize), split.frames - frame));
+
+			if (!split.read(frame, samples, a) || !reference.read(frame, samples, b))
+			{
+				error = "read error";
+				return false;
+			}
+
+			for (int c = 0; c < split.format.channels; ++c)
+			{
+				for (int s = 0; s < samples; ++s)
+				{
+					if (abs(a[c][s] - b[c][s]) > largest)
+					{
+						largest = abs(a[c][s] - b[c][s]);
+						at = frame + s;
+					}
+				}
+			}
+		}
+
+		if (largest == 0.0)
+			printf("%s: identical to a serial render\n", job.output.string().c_str());
+		else
+			printf("%s: largest difference from a serial render %.1f dBFS at %.3f s\n", job.output.string().c_str(),
+				20.0 * log10(largest), double(at) / split.format.sampleRate);
+
+		std::error_code ignored;
+		std::filesystem::remove(serial.output, ignored);
+
+		return true;
+	}
+
+	// Runs the detector only, the samples are read but nothing is written.
+	template <typename SampleType>
+	bool analyse(const Job& job, const Options& options, GainReductionStats& stats, double& sampleRate, std::string& error)
+	{
+		WavReader reader;
+
+		if (!openInput(reader, job, error))
+			return false;
+
+		OfflineProcessor processor(reader.format.sampleRate, options.doublePrecision, options.realtime);
+		applyOptions(processor, options);
+		sampleRate = reader.format.sampleRate;
+
+		std::vector<SampleType> buffer(2 * size_t(options.blockSize));
+		SampleType* in[2] = { buffer.data(), buffer.data() + options.blockSize };
+
+		for (uint64_t frame = 0; frame < reader.frames; frame += options.blockSize)
+		{
+			const int samples = int((std::min)(uint64_t(options.blockSize), reader.frames - frame));
+
+			if (!reader.read(frame, samples, in))
+			{
+				error = "read error";
+				return false;
+			}
+
+			if (reader.format.channels == 1)
+				std::copy(in[0], in[0] + samples, in[1]);
+
+			processor.analyse(in, samples, stats);
+		}
+
+		return true;
+	}
+
+	void printStats(const Job& job, const GainReductionStats& stats, double sampleRate, bool histogram)
+	{
+		printf("%s: max %.2f dB, average %.2f dB, median %.1f dB, p90 %.1f dB, p99 %.1f dB, above threshold %.1f%% (%.2f s)\n",
+			job.input.string().c_str(), stats.maxReduction, stats.averageReduction(),
+			stats.percentile(0.5), stats.percentile(0.9), stats.percentile(0.99),
+			100.0 * stats.fractionAboveThreshold(), double(stats.samplesAboveThreshold) / sampleRate);
+
+		if (!histogram)
+			return;
+
+		for (int i = 0; i < GainReductionStats::HISTOGRAM_SIZE; ++i)
+		{
+			if (stats.histogram[i] > 0)
+				printf("  %5.1f dB %8.3f%%\n", i * GainReductionStats::HISTOGRAM_STEP, 100.0 * double(stats.histogram[i]) / double(stats.samples));
+		}
+	}
+
+	bool parseArguments(int argc, char* argv[], Options& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string argument = argv[i];
+			const bool hasValue = i + 1 < argc;
+
+			if (argument == "--preset" && hasValue)
+			{
+				if (!readFile(argv[++i], options.preset))
+				{
+					fprintf(stderr, "Can't read preset %s\n", argv[i]);
+					return false;
+				}
+			}
+			else if (argument == "--set" && hasValue)
+			{
+				const std::string assignment = argv[++i];
+				const size_t equals = assignment.find('=');
+				const CustomParameter* parameter = equals == std::string::npos ? nullptr : parameterWithTitle(assignment.substr(0, equals));
+
+				if (!parameter)
+				{
+					fprintf(stderr, "Unknown parameter in %s\n", assignment.c_str());
+					return false;
+				}
+
+				const std::string text = assignment.substr(equals + 1);
+				double plain;
+
+				if (!ParameterFormat::parse(*parameter, text.c_str(), int(text.size()), plain))
+				{
+					fprintf(stderr, "Can't read the value in %s\n", assignment.c_str());
+					return false;
+				}
+
+				if (plain < parameter->minPlain || plain > parameter->maxPlain)
+				{
+					fprintf(stderr, "%s is outside %g to %g %s\n", assignment.c_str(), parameter->minPlain, parameter->maxPlain, parameter->units.c_str());
+					return false;
+				}
+
+				options.overrides.emplace_back(parameter->title, plain);
+			}
+			else if (argument == "--save-preset" && hasValue)
+			{
+				options.savePreset = argv[++i];
+			}
+			else if (argument == "--format" && hasValue)
+			{
+				const std::string format = argv[++i];
+				options.encoding = format == "16" ? WavFormat::Int16 : format == "24" ? WavFormat::Int24 : format == "32f" ? WavFormat::Float32 : WavFormat::Unsupported;
+
+				if (options.encoding == WavFormat::Unsupported)
+				{
+					fprintf(stderr, "Unknown format %s\n", format.c_str());
+					return false;
+				}
+			}
+			else if (argument == "--block" && hasValue)
+			{
+				if (!parseNumber(argv[++i], options.blockSize) || options.blockSize < 1 || options.blockSize > MAX_BUFFER_SIZE)
+				{
+					fprintf(stderr, "Block size %s isn't 1 to %d\n", argv[i], MAX_BUFFER_SIZE);
+					return false;
+				}
+			}
+			else if (argument == "--jobs" && hasValue)
+			{
+				if (!parseNumber(argv[++i], options.jobs) || options.jobs < 1)
+				{
+					fprintf(stderr, "Bad number of jobs %s\n", argv[i]);
+					return false;
+				}
+			}
+			else if (argument == "--out-dir" && hasValue)
+			{
+				options.outDir = argv[++i];
+			}
+			else if (argument == "--double")
+			{
+				options.doublePrecision = true;
+			}
+			else if (argument == "--realtime")
+			{
+				options.realtime = true;
+			}
+			else if (argument == "--split")
+			{
+				options.split = true;
+			}
+			else if (argument == "--preroll" && hasValue)
+			{
+				if (!parseNumber(argv[++i], options.preroll) || !(options.preroll >= 0.0 && std::isfinite(options.preroll)))
+				{
+					fprintf(stderr, "Bad pre-roll %s, seconds from 0\n", argv[i]);
+					return false;
+				}
+			}
+			else if (argument == "--verify")
+			{
+				options.verify = true;
+			}
+			else if (argument == "--analyse")
+			{
+				options.analyse = true;
+			}
+			else if (argument == "--histogram")
+			{
+				options.histogram = true;
+			}
+			else if (argument.starts_with("--"))
+			{
+				fprintf(stderr, "Unknown option %s\n", argument.c_str());
+				return false;
+			}
+			else
+			{
+				options.inputs.emplace_back(argument);
+			}
+		}
+
+		return true;
+	}
+
+	std::vector<Job> collectJobs(const Options& options)
+	{
+		std::vector<Job> jobs;
+
+		if (options.outDir.empty() && !options.analyse)
+		{
+			if (options.inputs.size() == 2)
+				jobs.push_back({ options.inputs[0], options.inputs[1] });
+
+			return jobs;
+		}
+
+		const auto isWav = [](const std::filesystem::path& path) {
+			std::string extension = path.extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return char(tolower(c)); });
+			return extension == ".wav" || extension == ".rf64";
+		};
+
+		for (const std::filesystem::path& input : options.inputs)
+		{
+			if (std::filesystem::is_directory(input))
+			{
+				for (const auto& entry : std::filesystem::directory_iterator(input))
+				{
+					if (entry.is_regular_file() && isWav(entry.path()))
+						jobs.push_back({ entry.path(), options.analyse ? std::filesystem::path() : options.outDir / entry.path().filename() });
+				}
+			}
+			else
+			{
+				jobs.push_back({ input, options.analyse ? std::filesystem::path() : options.outDir / input.filename() });
+			}
+		}
+
+		return jobs;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+
+	if (!parseArguments(argc, argv, options))
+		return 1;
+
+	if (!options.savePreset.empty())
+	{
+		OfflineProcessor processor(44100.0);
+		applyOptions(processor, options);
+
+		const std::vector<char> state = processor.getState();
+		std::ofstream(options.savePreset, std::ios::binary).write(state.data(), std::streamsize(state.size()));
+	}
+
+	const std::vector<Job> jobs = collectJobs(options);
+
+	if (jobs.empty())
+	{
+		if (options.savePreset.empty())
+			printUsage();
+
+		return options.savePreset.empty() ? 1 : 0;
+	}
+
+	if (!options.outDir.empty() && !options.analyse)
+		std::filesystem::create_directories(options.outDir);
+
+	// One file at a time, each on every worker.
+	if (options.split && !options.analyse)
+	{
+		const int segmentWorkers = options.jobs > 0 ? options.jobs : (std::max)(1, int(std::thread::hardware_concurrency()));
+		int failures = 0;
+
+		for (const Job& job : jobs)
+		{
+			std::string error;
+			bool succeeded = options.doublePrecision ? renderSplit<double>(job, options, segmentWorkers, error) : renderSplit<float>(job, options, segmentWorkers, error);
+
+			if (succeeded)
+				printf("%s -> %s\n", job.input.string().c_str(), job.output.string().c_str());
+
+			if (succeeded && options.verify)
+				succeeded = options.doublePrecision ? verifySplit<double>(job, options, error) : verifySplit<float>(job, options, error);
+
+			if (!succeeded)
+			{
+				fprintf(stderr, "%s: %s\n", job.input.string().c_str(), error.c_str());
+				++failures;
+			}
+		}
+
+		return failures > 0 ? 2 : 0;
+	}
+
+	const int workers = std::clamp(options.jobs > 0 ? options.jobs : int(std::thread::hardware_concurrency()), 1, int(jobs.size()));
+
+	std::atomic<size_t> next = 0;
+	std::atomic<int> failures = 0;
+	std::mutex printMutex;
+
+	const auto work = [&]() {
+		for (size_t index = next++; index < jobs.size(); index = next++)
+		{
+			const Job& job = jobs[index];
+			std::string error;
+
+			if (options.analyse)
+			{
+				GainReductionStats stats;
+				double sampleRate = 0.0;
+
+				const bool succeeded = options.doublePrecision ? analyse<double>(job, options, stats, sampleRate, error) : analyse<float>(job, options, stats, sampleRate, error);
+
+				std::lock_guard<std::mutex> lock(printMutex);
+
+				if (succeeded)
+				{
+					printStats(job, stats, sampleRate, options.histogram);
+				}
+				else
+				{
+					fprintf(stderr, "%s: %s\n", job.input.string().c_str(), error.c_str());
+					++failures;
+				}
+
+				continue;
+			}
+
+			const bool succeeded = options.doublePrecision ? render<double>(job, options, error) : render<float>(job, options, error);
+
+			std::lock_guard<std::mutex> lock(printMutex);
+
+			if (succeeded)
+			{
+				printf("%s -> %s\n", job.input.string().c_str(), job.output.string().c_str());
+			}
+			else
+			{
+				fprintf(stderr, "%s: %s\n", job.input.string().c_str(), error.c_str());
+				++failures;
+			}
+		}
+	};
+
+	std::vector<std::thread> pool;
+
+	for (int i = 1; i < workers; ++i)
+		pool.emplace_back(work);
+
+	work();
+
+	for (std::thread& thread : pool)
+		thread.join();
+
+	return failures > 0 ? 2 : 0;
+}
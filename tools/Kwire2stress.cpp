@@ -0,0 +1,420 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2025 Laser Brain.
+//------------------------------------------------------------------------
+
+// Host stand-in for multi-instance scaling tests.
+//
+//   Kwire2stress [--instances N] [--threads M] [--block B | --block mixed] [--seconds S]
+//                [--automation P] [--sample-rate SR]
+//
+// Creates N processors through the plug-in factory and runs them from M threads, one block for every
+// instance per cycle like a host's graph. Each layout is reported with its throughput and per-block latency:
+//   pinned     every thread keeps the same instances, their buffers stay in that core's caches
+//   migrating  instances move to another thread every cycle, so every block starts from cold caches
+//   packed     like pinned, but the threads' statistics share cache lines (false sharing). Every output
+//              sample goes through them, as through a host's meter, so the lines bounce between cores.
+
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pluginterfaces/base/ipluginbase.h"
+#include "pluginterfaces/vst/ivstcomponent.h"
+#include "pluginterfaces/vst/ivstaudioprocessor.h"
+#include "pluginterfaces/vst/ivstparameterchanges.h"
+
+#include "Kwire2processor.h"
+#include "ParameterChanges.h"
+
+using namespace Steinberg;
+using namespace Steinberg::Vst;
+
+namespace {
+	struct Options {
+		int instances = 64;
+		int threads = int((std::max)(1u, std::thread::hardware_concurrency()));
+		int blockSize = 256; // 0 for a mix of block sizes.
+		double seconds = 5.0;
+		double automation = 0.1;
+		double sampleRate = 48000.0;
+	};
+
+	struct Instance {
+		IComponent* component = nullptr;
+		IAudioProcessor* processor = nullptr;
+
+		std::vector<float> buffer;
+		float* in[2] = {};
+		float* out[2] = {};
+		AudioBusBuffers inputBus;
+		AudioBusBuffers outputBus;
+		ProcessContext context = {};
+		ParamChanges changes;
+	};
+
+	// Per thread statistics, padded to their own cache lines unless the layout measures false sharing.
+	// metered is written once per output sample. Relaxed atomics keep each write a store to memory,
+	// not a register the compiler sums in.
+	struct alignas(64) PaddedStats {
+		uint64_t blocks = 0;
+		uint64_t samples = 0;
+		std::atomic<uint64_t> metered = 0;
+	};
+
+	struct PackedStats {
+		uint64_t blocks = 0;
+		uint64_t samples = 0;
+		std::atomic<uint64_t> metered = 0;
+	};
+
+	// Counts the block's output samples into the thread's statistics one at a time.
+	template <typename Stats>
+	void meter(Stats& stats, const Instance& instance, int samples)
+	{
+		for (int c = 0; c < 2; ++c)
+		{
+			for (int s = 0; s < samples; ++s)
+			{
+				if (std::isfinite(instance.out[c][s]))
+					stats.metered.store(stats.metered.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	enum Layout {
+		Pinned,
+		Migrating,
+		Packed,
+		NumLayouts
+	};
+
+	const char* layoutNames[NumLayouts] = { "pinned", "migrating", "packed" };
+
+	IPluginFactory* factory()
+	{
+		static IPluginFactory* pluginFactory = GetPluginFactory();
+		return pluginFactory;
+	}
+
+	bool createInstance(Instance& instance, const Options& options)
+	{
+		IPluginFactory* pluginFactory = factory();
+
+		for (int32 i = 0; i < pluginFactory->countClasses(); ++i)
+		{
+			PClassInfo info;
+
+			if (pluginFactory->getClassInfo(i, &info) != kResultOk || strcmp(info.category, kVstAudioEffectClass) != 0)
+				continue;
+
+			if (pluginFactory->createInstance(info.cid, IComponent::iid, reinterpret_cast<void**>(&instance.component)) != kResultOk)
+				return false;
+
+			break;
+		}
+
+		if (!instance.component || instance.component->initialize(nullptr) != kResultOk)
+			return false;
+
+		if (instance.component->queryInterface(IAudioProcessor::iid, reinterpret_cast<void**>(&instance.processor)) != kResultOk)
+			return false;
+
+		ProcessSetup setup = { kRealtime, kSample32, MAX_BUFFER_SIZE, options.sampleRate };
+		instance.processor->setupProcessing(setup);
+		instance.component->setActive(true);
+		instance.processor->setProcessing(true);
+
+		instance.buffer.assign(4 * MAX_BUFFER_SIZE, 0.0f);
+
+		for (int c = 0; c < 2; ++c)
+		{
+			instance.in[c] = instance.buffer.data() + c * MAX_BUFFER_SIZE;
+			instance.out[c] = instance.buffer.data() + (2 + c) * MAX_BUFFER_SIZE;
+		}
+
+		instance.inputBus.numChannels = instance.outputBus.numChannels = 2;
+		instance.inputBus.channelBuffers32 = instance.in;
+		instance.outputBus.channelBuffers32 = instance.out;
+		instance.context.sampleRate = options.sampleRate;
+
+		return true;
+	}
+
+	void destroyInstance(Instance& instance)
+	{
+		if (instance.processor)
+		{
+			instance.processor->setProcessing(false);
+			instance.processor->release();
+		}
+
+		if (instance.component)
+		{
+			instance.component->setActive(false);
+			instance.component->terminate();
+			instance.component->release();
+		}
+	}
+
+	// Input noise and a few automation points for the next block.
+	void prepareBlock(Instance& instance, int samples, double automation, std::minstd_rand& random)
+	{
+		std::uniform_real_distribution<float> noise(-0.5f, 0.5f);
+		std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+		for (int c = 0; c < 2; ++c)
+			for (int s = 0; s < samples; ++s)
+				instance.in[c][s] = noise(random);
+
+		instance.changes.count = 0;
+
+		// Audit builds also automate bypass, send several points per parameter and silent blocks,
+		// so every path through process() runs.
+		const ParamID automated = RealtimeAudit::enabled ? nParams : bypassId;
+		const int32 points = RealtimeAudit::enabled ? ParamQueue::MAX_POINTS : 1;
+
+		instance.inputBus.silenceFlags = RealtimeAudit::enabled && random() % 16 == 0 ? 3 : 0;
+
+		for (ParamID id = 0; id < automated; ++id)
+		{
+			if (unit(random) >= automation / automated)
+				continue;
+
+			int32 index;
+
+			if (IParamValueQueue* queue = instance.changes.addParameterData(id, index))
+			{
+				for (int32 p = 0; p < points; ++p)
+					queue->addPoint(int32(random() % samples), unit(random), index);
+			}
+		}
+	}
+
+	struct Result {
+		double seconds = 0;
+		uint64_t samples = 0;
+		uint64_t blocks = 0;
+		uint64_t overruns = 0;
+		std::vector<double> latencies;
+	};
+
+	template <typename Stats>
+	Result run(std::vector<Instance>& instances, const Options& options, Layout layout)
+	{
+		static constexpr int blockSizes[] = { 32, 64, 128, 256, 512, 1024 };
+
+		const int threads = options.threads;
+		const int instanceCount = int(instances.size());
+		const auto duration = std::chrono::duration<double>(options.seconds);
+
+		std::vector<Stats> stats(threads);
+		std::vector<std::vector<double>> latencies(threads);
+		std::atomic<bool> running = true;
+		std::atomic<uint64_t> overruns = 0;
+
+		int cycle = 0;
+		int samples = options.blockSize > 0 ? options.blockSize : blockSizes[0];
+		std::chrono::steady_clock::time_point cycleStart = std::chrono::steady_clock::now();
+		const std::chrono::steady_clock::time_point start = cycleStart;
+		std::minstd_rand hostRandom(1);
+
+		// Runs on one thread between cycles, like the host picking the next block.
+		auto nextCycle = [&]() noexcept {
+			const auto now = std::chrono::steady_clock::now();
+
+			if (std::chrono::duration<double>(now - cycleStart).count() > samples / options.sampleRate)
+				++overruns;
+
+			if (now - start > duration)
+				running = false;
+
+			if (options.blockSize == 0)
+				samples = blockSizes[hostRandom() % std::size(blockSizes)];
+
+			cycleStart = now;
+			++cycle;
+		};
+
+		std::barrier sync(threads, nextCycle);
+
+		auto work = [&](int thread) {
+			std::minstd_rand random(thread + 1);
+			std::vector<double>& threadLatencies = latencies[thread];
+			threadLatencies.reserve(size_t(options.seconds * options.sampleRate / 32) * (instanceCount / threads + 1));
+
+			while (running)
+			{
+				// Pinned layouts keep instance i on thread i % threads, migrating shifts by one thread per cycle.
+				const int shift = layout == Migrating ? cycle : 0;
+
+				for (int i = 0; i < instanceCount; ++i)
+				{
+					if ((i + shift) % threads != thread)
+						continue;
+
+					Instance& instance = instances[i];
+					prepareBlock(instance, samples, options.automation, random);
+
+					ProcessData data;
+					data.processMode = kRealtime;
+					data.symbolicSampleSize = kSample32;
+					data.numSamples = samples;
+					data.numInputs = data.numOutputs = 1;
+					data.inputs = &instance.inputBus;
+					data.outputs = &instance.outputBus;
+					data.inputParameterChanges = &instance.changes;
+					data.processContext = &instance.context;
+
+					const auto before = std::chrono::steady_clock::now();
+					instance.processor->process(data);
+					const auto after = std::chrono::steady_clock::now();
+
+					threadLatencies.push_back(std::chrono::duration<double, std::micro>(after - before).count());
+
+					stats[thread].blocks++;
+					stats[thread].samples += samples;
+					meter(stats[thread], instance, samples);
+				}
+
+				sync.arrive_and_wait();
+			}
+		};
+
+		std::vector<std::thread> pool;
+
+		for (int t = 1; t < threads; ++t)
+			pool.emplace_back(work, t);
+
+		work(0);
+
+		for (std::thread& thread : pool)
+			thread.join();
+
+		Result result;
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		result.overruns = overruns;
+
+		for (int t = 0; t < threads; ++t)
+		{
+			result.blocks += stats[t].blocks;
+			result.samples += stats[t].samples;
+			result.latencies.insert(result.latencies.end(), latencies[t].begin(), latencies[t].end());
+		}
+
+		return result;
+	}
+
+	double percentile(std::vector<double>& sorted, double p)
+	{
+		if (sorted.empty())
+			return 0.0;
+
+		return sorted[(std::min)(sorted.size() - 1, size_t(p * double(sorted.size())))];
+	}
+
+	void report(const char* name, Result& result, const Options& options)
+	{
+		std::sort(result.latencies.begin(), result.latencies.end());
+
+		const double realtime = double(result.samples) / options.sampleRate / result.seconds;
+
+		printf("%-10s %10.1f %12.1f %9.2f %9.2f %9.2f %9.2f %9llu\n", name,
+			double(result.blocks) / result.seconds, realtime,
+			percentile(result.latencies, 0.5), percentile(result.latencies, 0.99), percentile(result.latencies, 0.999),
+			result.latencies.empty() ? 0.0 : result.latencies.back(), (unsigned long long)result.overruns);
+	}
+
+	bool parseArguments(int argc, char* argv[], Options& options)
+	{
+		for (int i = 1; i + 1 < argc; i += 2)
+		{
+			const std::string argument = argv[i];
+			const char* value = argv[i + 1];
+
+			if (argument == "--instances")
+				options.instances = (std::max)(1, atoi(value));
+			else if (argument == "--threads")
+				options.threads = (std::max)(1, atoi(value));
+			else if (argument == "--block")
+				options.blockSize = std::string(value) == "mixed" ? 0 : std::clamp(atoi(value), 1, MAX_BUFFER_SIZE);
+			else if (argument == "--seconds")
+				options.seconds = atof(value);
+			else if (argument == "--automation")
+				options.automation = std::clamp(atof(value), 0.0, 1.0);
+			else if (argument == "--sample-rate")
+				options.sampleRate = atof(value);
+			else
+				return false;
+		}
+
+		return (argc - 1) % 2 == 0;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+
+	if (!parseArguments(argc, argv, options))
+	{
+		printf("Usage: Kwire2stress [--instances N] [--threads M] [--block B | mixed] [--seconds S] [--automation P] [--sample-rate SR]\n");
+		return 1;
+	}
+
+	std::vector<Instance> instances(options.instances);
+
+	for (Instance& instance : instances)
+	{
+		if (!createInstance(instance, options))
+		{
+			fprintf(stderr, "Failed to create an instance through the plug-in factory\n");
+			return 1;
+		}
+	}
+
+	printf("%d instances, %d threads, block %s, %.0f Hz, automation %.2f per block\n", options.instances, options.threads,
+		options.blockSize > 0 ? std::to_string(options.blockSize).c_str() : "mixed", options.sampleRate, options.automation);
+	printf("Processor size %zu bytes, buffer alignment %zu\n\n", sizeof(Kwire2::Kwire2Processor), BUFFER_ALIGNMENT);
+	printf("%-10s %10s %12s %9s %9s %9s %9s %9s\n", "layout", "blocks/s", "x realtime", "p50 us", "p99 us", "p99.9 us", "max us", "overruns");
+
+	for (int layout = 0; layout < NumLayouts; ++layout)
+	{
+		Result result = layout == Packed ? run<PackedStats>(instances, options, Layout(layout)) : run<PaddedStats>(instances, options, Layout(layout));
+		report(layoutNames[layout], result, options);
+	}
+
+	// Every instance's own meter, as its editor shows it, after the last layout.
+	std::vector<float> loads;
+	float loadPeak = 0.0f;
+
+	for (Instance& instance : instances)
+	{
+		const LoadMeter::Reading load = static_cast<Kwire2::Kwire2Processor*>(instance.processor)->load();
+
+		loads.push_back(load.average);
+		loadPeak = (std::max)(loadPeak, load.peak);
+	}
+
+	std::sort(loads.begin(), loads.end());
+	printf("\nDSP load per instance: min %.2f%%, median %.2f%%, max %.2f%%, peak %.2f%%\n",
+		100.0 * loads.front(), 100.0 * loads[loads.size() / 2], 100.0 * loads.back(), 100.0 * loadPeak);
+
+	for (Instance& instance : instances)
+		destroyInstance(instance);
+
+	if constexpr (RealtimeAudit::enabled)
+	{
+		printf("\n%llu real-time violations\n", (unsigned long long)RealtimeAudit::violations());
+
+		if (RealtimeAudit::violations() > 0)
+			return 2;
+	}
+
+	return 0;
+}
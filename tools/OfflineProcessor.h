@@ -0,0 +1,157 @@
+#pragma once
+
+#include <vector>
+
+#include "base/source/fstreamer.h"
+#include "public.sdk/source/common/memorystream.h"
+#include "pluginterfaces/base/smartpointer.h"
+
+#include "Kwire2processor.h"
+
+// Drives a Kwire2Processor without a host, for offline rendering.
+class OfflineProcessor {
+public:
+	// Realtime processing follows the Quality parameter, offline processing always uses High.
+	// Drives instance if given, eg. a subclass that exposes the processor's buffers.
+	OfflineProcessor(double sampleRate, bool doublePrecision = false, bool realtime = false, Kwire2::Kwire2Processor* instance = nullptr)
+	{
+		using namespace Steinberg::Vst;
+
+		const int32 processMode = realtime ? kRealtime : kOffline;
+
+		processor = Steinberg::owned(instance ? instance : new Kwire2::Kwire2Processor());
+		processor->initialize(nullptr);
+
+		ProcessSetup setup = { processMode, doublePrecision ? kSample64 : kSample32, MAX_BUFFER_SIZE, sampleRate };
+		processor->setupProcessing(setup);
+		processor->setActive(true);
+		processor->setProcessing(true);
+
+		context.sampleRate = sampleRate;
+
+		data.processMode = processMode;
+		data.symbolicSampleSize = setup.symbolicSampleSize;
+		data.numInputs = 1;
+		data.numOutputs = 1;
+		data.inputs = &inputBus;
+		data.outputs = &outputBus;
+		data.processContext = &context;
+
+		inputBus.numChannels = 2;
+		outputBus.numChannels = 2;
+	}
+
+	~OfflineProcessor()
+	{
+		processor->setProcessing(false);
+		processor->setActive(false);
+		processor->terminate();
+	}
+
+	// State in the format written by Kwire2Processor::getState.
+	bool setState(const std::vector<char>& state)
+	{
+		Steinberg::MemoryStream stream(const_cast<char*>(state.data()), Steinberg::TSize(state.size()));
+		const Steinberg::uint32 latency = processor->getLatencySamples();
+
+		if (processor->setState(&stream) != Steinberg::kResultOk)
+			return false;
+
+		// A host restarts processing for a new latency, the crossover phase and partition are taken up then.
+		if (processor->getLatencySamples() != latency)
+		{
+			processor->setProcessing(false);
+			processor->setActive(false);
+			processor->setActive(true);
+			processor->setProcessing(true);
+		}
+
+		return true;
+	}
+
+	// Samples the output lags the input, see Kwire2Processor::getLatencySamples.
+	int latency()
+	{
+		return int(processor->getLatencySamples());
+	}
+
+	std::vector<char> getState()
+	{
+		Steinberg::MemoryStream stream;
+		processor->getState(&stream);
+
+		return std::vector<char>(stream.getData(), stream.getData() + stream.getSize());
+	}
+
+	// Plain value of a parameter in the current state.
+	double plainValue(Steinberg::Vst::ParamID id)
+	{
+		const std::vector<char> state = getState();
+		Steinberg::MemoryStream stream(const_cast<char*>(state.data()), Steinberg::TSize(state.size()));
+		Steinberg::IBStreamer streamer(&stream, kLittleEndian);
+
+		while (const char* title = streamer.readStr8())
+		{
+			double value;
+
+			if (!streamer.readDouble(value))
+				break;
+
+			if (customParameters[id].title == title)
+				return value;
+		}
+
+		return customParameters[id].defaultPlain;
+	}
+
+	// Processes up to MAX_BUFFER_SIZE samples of two channels, float or double depending on the precision.
+	template <typename SampleType>
+	void process(SampleType** in, SampleType** out, int samples, Steinberg::Vst::IParameterChanges* changes = nullptr)
+	{
+		if constexpr (std::is_same_v<SampleType, double>)
+		{
+			inputBus.channelBuffers64 = in;
+			outputBus.channelBuffers64 = out;
+		}
+		else
+		{
+			inputBus.channelBuffers32 = in;
+			outputBus.channelBuffers32 = out;
+		}
+
+		inputBus.silenceFlags = 0;
+		data.numSamples = samples;
+		data.inputParameterChanges = changes;
+		context.projectTimeSamples = position;
+
+		processor->process(data);
+		position += samples;
+	}
+
+	// Runs only the detector, adding the gain reduction to stats.
+	template <typename SampleType>
+	void analyse(SampleType** in, int samples, GainReductionStats& stats)
+	{
+		if constexpr (std::is_same_v<SampleType, double>)
+			inputBus.channelBuffers64 = in;
+		else
+			inputBus.channelBuffers32 = in;
+
+		inputBus.silenceFlags = 0;
+		data.numSamples = samples;
+		data.inputParameterChanges = nullptr;
+		context.projectTimeSamples = position;
+
+		processor->analyse(data, stats);
+		position += samples;
+	}
+
+	Steinberg::IPtr<Kwire2::Kwire2Processor> processor;
+
+private:
+	Steinberg::Vst::ProcessData data;
+	Steinberg::Vst::ProcessContext context = {};
+	Steinberg::Vst::AudioBusBuffers inputBus;
+	Steinberg::Vst::AudioBusBuffers outputBus;
+	Steinberg::int64 position = 0;
+};
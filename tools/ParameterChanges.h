@@ -0,0 +1,68 @@
+#pragma once
+
+#include "pluginterfaces/vst/ivstparameterchanges.h"
+
+#include "parameters.h"
+
+// Fixed capacity parameter changes for the command line hosts, so they don't allocate while timing.
+class ParamQueue : public Steinberg::Vst::IParamValueQueue {
+public:
+	Steinberg::Vst::ParamID PLUGIN_API getParameterId() SMTG_OVERRIDE { return id; }
+	Steinberg::int32 PLUGIN_API getPointCount() SMTG_OVERRIDE { return count; }
+
+	Steinberg::tresult PLUGIN_API getPoint(Steinberg::int32 index, Steinberg::int32& sampleOffset, Steinberg::Vst::ParamValue& value) SMTG_OVERRIDE
+	{
+		if (index < 0 || index >= count)
+			return Steinberg::kResultFalse;
+
+		sampleOffset = offsets[index];
+		value = values[index];
+		return Steinberg::kResultOk;
+	}
+
+	Steinberg::tresult PLUGIN_API addPoint(Steinberg::int32 sampleOffset, Steinberg::Vst::ParamValue value, Steinberg::int32& index) SMTG_OVERRIDE
+	{
+		if (count == MAX_POINTS)
+			return Steinberg::kResultFalse;
+
+		offsets[count] = sampleOffset;
+		values[count] = value;
+		index = count++;
+		return Steinberg::kResultOk;
+	}
+
+	Steinberg::tresult PLUGIN_API queryInterface(const Steinberg::TUID, void**) SMTG_OVERRIDE { return Steinberg::kNoInterface; }
+	Steinberg::uint32 PLUGIN_API addRef() SMTG_OVERRIDE { return 1; }
+	Steinberg::uint32 PLUGIN_API release() SMTG_OVERRIDE { return 1; }
+
+	static constexpr Steinberg::int32 MAX_POINTS = 4;
+
+	Steinberg::Vst::ParamID id = 0;
+	Steinberg::int32 count = 0;
+	Steinberg::int32 offsets[MAX_POINTS] = {};
+	Steinberg::Vst::ParamValue values[MAX_POINTS] = {};
+};
+
+class ParamChanges : public Steinberg::Vst::IParameterChanges {
+public:
+	Steinberg::int32 PLUGIN_API getParameterCount() SMTG_OVERRIDE { return count; }
+	Steinberg::Vst::IParamValueQueue* PLUGIN_API getParameterData(Steinberg::int32 index) SMTG_OVERRIDE { return index >= 0 && index < count ? &queues[index] : nullptr; }
+
+	Steinberg::Vst::IParamValueQueue* PLUGIN_API addParameterData(const Steinberg::Vst::ParamID& id, Steinberg::int32& index) SMTG_OVERRIDE
+	{
+		if (count == nTotalParams)
+			return nullptr;
+
+		queues[count].id = id;
+		queues[count].count = 0;
+		index = count++;
+		return &queues[index];
+	}
+
+	Steinberg::tresult PLUGIN_API queryInterface(const Steinberg::TUID, void**) SMTG_OVERRIDE { return Steinberg::kNoInterface; }
+	Steinberg::uint32 PLUGIN_API addRef() SMTG_OVERRIDE { return 1; }
+	Steinberg::uint32 PLUGIN_API release() SMTG_OVERRIDE { return 1; }
+
+	Steinberg::int32 count = 0;
+	ParamQueue queues[nTotalParams];
+};
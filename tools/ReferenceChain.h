@@ -0,0 +1,385 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <vector>
+
+#include "constants.h"
+#include "parameters.h"
+
+// Frozen scalar model of the processor's chain at Normal quality, for Kwire2oracle. Decimation is the
+// processor's detector decimation at the sample rate, Eco and Normal use it.
+//
+// One sample at a time through every stage, in double precision, with the gain computer in exact
+// log10 and pow. It doesn't share code with the processor's kernels, so a kernel can be vectorised,
+// tabled or moved to float and still be checked against what the chain computed before. Parameters
+// come from the processor's rendered rows: the parameter layer isn't what is being checked.
+//
+// With a partition, the crossover is the linear phase one: its kernel designed as LinearPhaseCrossover
+// describes it, by a direct inverse DFT rather than FFT.h, and run as a direct FIR lagging the
+// partition, rather than by PartitionedConvolver. The saturated signal and the dry input are delayed
+// by the latency, half the kernel and the partition. The kernel is designed again when the cutoff
+// at the start of a block changes; the oracle keeps it still, the processor only swaps kernels
+// between partitions.
+//
+// Only change this when the chain is meant to sound different, together with that change.
+class ReferenceChain {
+public:
+	// Per sample value of every stage the oracle compares.
+	struct Stages {
+		double saturated[2][MAX_BUFFER_SIZE];
+		double filtered[2][MAX_BUFFER_SIZE];
+		double midGain[MAX_BUFFER_SIZE];
+		double sideGain[MAX_BUFFER_SIZE];
+		double wet[2][MAX_BUFFER_SIZE];
+		double output[2][MAX_BUFFER_SIZE];
+
+		// Level the mid and side gains act on, |mid| + |side| before the clipper, and the same at the output.
+		// An error in either gain scales with it, even where the channels cancel or clip.
+		double wetLevel[MAX_BUFFER_SIZE];
+		double outputLevel[MAX_BUFFER_SIZE];
+	};
+
+	ReferenceChain(double sr, int detectorDecimation, int linearPartition = 0) :
+		sampleRate(sr),
+		decimation(detectorDecimation),
+		partition(linearPartition)
+	{
+		if (!partition)
+			return;
+
+		taps = int(std::bit_ceil(unsigned(std::ceil(0.05 * sampleRate))));
+		latency = taps / 2 + partition;
+		history = int(std::bit_ceil(unsigned(taps + partition)));
+
+		for (int c = 0; c < 2; ++c)
+		{
+			saturatedRing[c].assign(2 * size_t(history), 0.0);
+			dryRing[c].assign(2 * size_t(history), 0.0);
+		}
+	}
+
+	// Blocks the processor passed through untouched (fully bypassed) leave the state alone.
+	// controlPhase and interval are the processor's control grid at the start of the block.
+	void process(const double* const* input, int samples, const double (*param)[MAX_BUFFER_SIZE],
+		int controlPhase, int interval, bool bypassed, Stages& stages)
+	{
+		if (bypassed)
+		{
+			for (int c = 0; c < 2; ++c)
+				std::copy(input[c], input[c] + samples, stages.output[c]);
+
+			return;
+		}
+
+		const double driveTimeSamples = 113.0 * sampleRate * 0.001;
+
+		if (partition && param[crossoverId][0] != designedCutoff)
+			designKernel(param[crossoverId][0]);
+
+		for (int s = 0; s < samples; ++s)
+		{
+			double saturated[2];
+			double dry[2] = { input[0][s], input[1][s] };
+
+			// Input gain and saturation
+			for (int c = 0; c < 2; ++c)
+			{
+				const double x = input[c][s] * param[inGainId][s];
+
+				driveEnvelope[c] += (std::abs(x) - driveEnvelope[c]) / driveTimeSamples;
+
+				const double factor = x + (std::min)(driveEnvelope[c], 1.4);
+				const double clean = (std::min)(1.0, 3.2 * driveEnvelope[c]);
+
+				saturated[c] = clean * x + (1.0 - clean) * x * (27.0 + factor * x) / (27.0 + 9.0 * factor * x);
+				stages.saturated[c][s] = saturated[c];
+			}
+
+			// Linear phase crossover, the wet and dry signals delayed to match
+			if (partition)
+			{
+				const int write = int(written & (history - 1));
+
+				for (int c = 0; c < 2; ++c)
+				{
+					saturatedRing[c][write] = saturatedRing[c][write + history] = saturated[c];
+					dryRing[c][write] = dryRing[c][write + history] = dry[c];
+
+					// Oldest tap first, the kernel is stored reversed.
+					const double* window = saturatedRing[c].data() + ((written - partition - (taps - 1)) & (history - 1));
+					double sum = 0.0;
+
+					for (int t = 0; t < taps; ++t)
+						sum += reversedKernel[t] * window[t];
+
+					stages.filtered[c][s] = sum;
+
+					const int delayed = int((written - latency) & (history - 1));
+					stages.saturated[c][s] = saturatedRing[c][delayed];
+					dry[c] = dryRing[c][delayed];
+				}
+
+				++written;
+			}
+
+			// Crossover, a state variable highpass retuned on control points
+			if (!partition && (controlPhase + s) % interval == 0)
+			{
+				const double cutoff = std::clamp(param[crossoverId][s], 5.0, 20000.0);
+
+				g = std::tan(M_PI * cutoff / sampleRate);
+				h = 1.0 / (1.0 + R2 * g + g * g);
+			}
+
+			for (int c = 0; c < 2 && !partition; ++c)
+			{
+				const double highpass = h * (saturated[c] - (s1[c] * (g + R2) + s2[c]));
+				const double bandpass = highpass * g + s1[c];
+
+				s1[c] = highpass * g + bandpass;
+				s2[c] = bandpass * g + (bandpass * g + s2[c]);
+
+				stages.filtered[c][s] = highpass;
+			}
+
+			// Sidechain EQ, state variable bands in series with their outputs mixed, retuned on control points
+			if ((controlPhase + s) % interval == 0)
+			{
+				for (int b = 0; b < 4; ++b)
+					tuneBand(b, param, s);
+			}
+
+			for (int b = 0; b < 4; ++b)
+			{
+				if (band[b].type == 0)
+					continue;
+
+				for (int c = 0; c < 2; ++c)
+				{
+					EqBand& eq = band[b];
+					const double highpass = eq.h * (stages.filtered[c][s] - (eq.s1[c] * (eq.g + eq.k) + eq.s2[c]));
+					const double bandpass = highpass * eq.g + eq.s1[c];
+					const double lowpass = bandpass * eq.g + eq.s2[c];
+
+					eq.s1[c] = highpass * eq.g + bandpass;
+					eq.s2[c] = bandpass * eq.g + lowpass;
+
+					stages.filtered[c][s] = eq.m[0] * stages.filtered[c][s] + eq.m[1] * bandpass + eq.m[2] * lowpass;
+				}
+			}
+
+			// Detector level, the sum of the rectified channels
+			const double level = std::abs(stages.filtered[0][s]) + std::abs(stages.filtered[1][s]);
+
+			if (decimation == 1)
+			{
+				stepEnvelopes(level, param, s, sampleRate);
+
+				stages.midGain[s] = midEnvelope;
+				stages.sideGain[s] = sideEnvelope;
+			}
+			else
+			{
+				// One step on the peak of each group, with the parameters of its last sample. The gains
+				// ramp from the envelopes of the group before to the last group's.
+				groupPeak = (std::max)(groupPeak, level);
+
+				if (++groupPhase == decimation)
+				{
+					stepEnvelopes(groupPeak, param, s, sampleRate / decimation);
+
+					groupPhase = 0;
+					groupPeak = 0.0;
+
+					rampFrom[0] = rampTo[0];
+					rampFrom[1] = rampTo[1];
+					rampTo[0] = midEnvelope;
+					rampTo[1] = sideEnvelope;
+				}
+
+				const double position = double(groupPhase) / double(decimation);
+
+				stages.midGain[s] = rampFrom[0] + position * (rampTo[0] - rampFrom[0]);
+				stages.sideGain[s] = rampFrom[1] + position * (rampTo[1] - rampFrom[1]);
+			}
+
+
+			// Mid/side attenuation of the saturated signal
+			const double mid = 0.5 * (stages.saturated[0][s] + stages.saturated[1][s]) * stages.midGain[s];
+			const double side = 0.5 * (stages.saturated[0][s] - stages.saturated[1][s]) * stages.sideGain[s];
+
+			const double wet[2] = { mid + side, mid - side };
+
+			stages.wetLevel[s] = std::abs(mid) + std::abs(side);
+			stages.outputLevel[s] = stages.wetLevel[s] * param[mixId][s] * param[outGainId][s];
+
+			for (int c = 0; c < 2; ++c)
+			{
+				// Clipper
+				const double q = (std::max)(0.0, param[clipThresholdId][s] - 0.15);
+				const double clamped = std::clamp(wet[c], -q, q);
+				const double over = std::clamp((wet[c] - clamped) / 0.15, -3.0, 3.0);
+				const double clipped = clamped + over * (27.0 + over * over) / (27.0 + 9.0 * over * over) * 0.15;
+
+				stages.wet[c][s] = (1.0 - param[clipMixId][s]) * wet[c] + param[clipMixId][s] * clipped;
+
+				// Dry/wet, output gain and the bypass crossfade
+				const double processed = stages.wet[c][s] * param[mixId][s] * param[outGainId][s] + dry[c] * (1.0 - param[mixId][s]);
+				stages.output[c][s] = processed * (1.0 - param[bypassId][s]) + dry[c] * param[bypassId][s];
+			}
+		}
+	}
+
+private:
+	// The highpass response sampled on the warped bins, its sign alternating to centre it on half the
+	// kernel, then windowed. Real and even, so the inverse DFT is a cosine sum.
+	void designKernel(double cutoffFrequency)
+	{
+		designedCutoff = cutoffFrequency;
+
+		const double cutoff = std::clamp(cutoffFrequency, 5.0, 20000.0);
+		const double g = std::tan(M_PI * cutoff / sampleRate);
+
+		std::vector<double> bins(taps / 2 + 1),
+			cosine(taps);
+
+		for (int k = 0; k < taps / 2; ++k)
+		{
+			const double w = std::tan(M_PI * k / taps) / g;
+			const double magnitude = w * w / std::sqrt((1.0 - w * w) * (1.0 - w * w) + R2 * R2 * w * w);
+
+			bins[k] = k & 1 ? -magnitude : magnitude;
+		}
+
+		bins[taps / 2] = 1.0;
+
+		for (int i = 0; i < taps; ++i)
+			cosine[i] = std::cos(2.0 * M_PI * i / taps);
+
+		reversedKernel.assign(taps, 0.0);
+
+		for (int t = 0; t < taps; ++t)
+		{
+			double sum = bins[0] + (t & 1 ? -bins[taps / 2] : bins[taps / 2]);
+
+			for (int k = 1; k < taps / 2; ++k)
+				sum += 2.0 * bins[k] * cosine[size_t(k) * t & (taps - 1)];
+
+			const double window = 0.42 - 0.5 * std::cos(2.0 * M_PI * t / taps) + 0.08 * std::cos(4.0 * M_PI * t / taps);
+
+			reversedKernel[taps - 1 - t] = sum * window / taps;
+		}
+	}
+
+	// Types in the order of the type parameters' values: off, low shelf, bell, high shelf, highpass, lowpass.
+	// A band switched on starts from a clear state.
+	void tuneBand(int b, const double (*param)[MAX_BUFFER_SIZE], int s)
+	{
+		const ParamID offset = b * EQ_BAND_PARAMS;
+		const int type = std::clamp(int(std::lround(param[eq1TypeId + offset][s])), 0, 5);
+		EqBand& eq = band[b];
+
+		if (eq.type == 0 && type != 0)
+			eq = EqBand();
+
+		eq.type = type;
+
+		const double A = std::pow(10.0, param[eq1GainId + offset][s] / 40.0);
+		const double q = (std::max)(0.01, param[eq1QId + offset][s]);
+		const double frequency = std::clamp(param[eq1FrequencyId + offset][s], 5.0, 0.49 * sampleRate);
+
+		eq.g = std::tan(M_PI * frequency / sampleRate);
+		eq.k = 1.0 / q;
+
+		switch (type)
+		{
+		case 1: eq.g /= std::sqrt(A); eq.m[0] = 1.0; eq.m[1] = eq.k * (A - 1.0); eq.m[2] = A * A - 1.0; break;
+		case 2: eq.k = 1.0 / (q * A); eq.m[0] = 1.0; eq.m[1] = eq.k * (A * A - 1.0); eq.m[2] = 0.0; break;
+		case 3: eq.g *= std::sqrt(A); eq.m[0] = A * A; eq.m[1] = eq.k * (1.0 - A) * A; eq.m[2] = 1.0 - A * A; break;
+		case 4: eq.m[0] = 1.0; eq.m[1] = -eq.k; eq.m[2] = -1.0; break;
+		case 5: eq.m[0] = 0.0; eq.m[1] = 0.0; eq.m[2] = 1.0; break;
+		}
+
+		eq.h = 1.0 / (1.0 + eq.k * eq.g + eq.g * eq.g);
+	}
+
+	// Static curves, the side one moved by the side settings, and the envelopes following them with
+	// their own times. rate is the rate of the steps.
+	void stepEnvelopes(double level, const double (*param)[MAX_BUFFER_SIZE], int s, double rate)
+	{
+		const double levelDb = (std::max)(-120.0, 20.0 * std::log10(level));
+
+		const double midAttenuation = attenuation(levelDb, param[thresholdId][s], param[ratioId][s], param[kneeId][s]);
+		const double sideAttenuation = attenuation(levelDb, param[thresholdId][s] + param[sideThresholdId][s],
+			param[ratioId][s] * param[sideRatioId][s], param[kneeId][s]);
+
+		const double attack = param[attackId][s] * 0.001 * rate;
+		const double release = param[releaseId][s] * 0.001 * rate;
+
+		const double midAttack = (std::max)(1.0, attack);
+		const double midRelease = (std::max)(1.0, release);
+		const double sideAttack = (std::max)(1.0, attack * param[sideAttackId][s]);
+		const double sideRelease = (std::max)(1.0, release * param[sideReleaseId][s]);
+
+		midEnvelope += (midAttenuation - midEnvelope) / (midAttenuation >= midEnvelope ? midRelease : midAttack);
+		sideEnvelope += (sideAttenuation - sideEnvelope) / (sideAttenuation >= sideEnvelope ? sideRelease : sideAttack);
+	}
+
+	static double attenuation(double levelDb, double threshold, double ratio, double knee)
+	{
+		const double overshoot = levelDb - threshold;
+
+		double reduction = -ratio * overshoot;
+
+		if (2.0 * overshoot <= -knee)
+			reduction = 0.0;
+		else if (2.0 * overshoot < knee)
+			reduction = -ratio * (overshoot + 0.5 * knee) * (overshoot + 0.5 * knee) / (2.0 * knee);
+
+		return std::pow(10.0, reduction / 20.0);
+	}
+
+	double sampleRate;
+
+	double driveEnvelope[2] = { 0.0, 0.0 };
+
+	// Filter coefficients and integrator states, no resonance.
+	const double R2 = 2.0;
+	double g = 0.0,
+		h = 0.0;
+	double s1[2] = { 0.0, 0.0 },
+		s2[2] = { 0.0, 0.0 };
+
+	// Linear phase crossover, off without a partition. The rings hold each signal twice over, so a
+	// window of history is contiguous.
+	int partition,
+		taps = 0,
+		latency = 0,
+		history = 0;
+	double designedCutoff = -1.0;
+	std::vector<double> reversedKernel;
+	std::vector<double> saturatedRing[2],
+		dryRing[2];
+	size_t written = 0;
+
+	struct EqBand {
+		int type = 0;
+		double g = 0.0,
+			k = 0.0,
+			h = 0.0;
+		double m[3] = { 0.0, 0.0, 0.0 };
+		double s1[2] = { 0.0, 0.0 },
+			s2[2] = { 0.0, 0.0 };
+	} band[4];
+
+	double midEnvelope = 1.0,
+		sideEnvelope = 1.0;
+
+	int decimation;
+	int groupPhase = 0;
+	double groupPeak = 0.0;
+	double rampFrom[2] = { 1.0, 1.0 },
+		rampTo[2] = { 1.0, 1.0 };
+};
@@ -0,0 +1,355 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include "MappedFile.h"
+
+// WAV and RF64 files, read and written through a MappedFile.
+// Samples are converted to and from deinterleaved float or double channel buffers.
+
+struct WavFormat {
+	enum Encoding {
+		Int16,
+		Int24,
+		Int32,
+		Float32,
+		Float64,
+		Unsupported
+	};
+
+	int channels = 2;
+	double sampleRate = 44100;
+	Encoding encoding = Float32;
+
+	int bytesPerSample() const
+	{
+		static constexpr int bytes[] = { 2, 3, 4, 4, 8, 0 };
+		return bytes[encoding];
+	}
+
+	int blockAlign() const { return channels * bytesPerSample(); }
+};
+
+//=========================================
+// Sample conversion. Plain loops over one channel so the compiler can vectorize them.
+
+namespace WavConversion {
+	template <typename T>
+	inline static void fromInt16(const uint8_t* src, int stride, T* dst, int count)
+	{
+		constexpr T scale = T(1.0 / 32768.0);
+
+		for (int i = 0; i < count; ++i)
+		{
+			int16_t v;
+			memcpy(&v, src + i * stride, sizeof(v));
+			dst[i] = T(v) * scale;
+		}
+	}
+
+	template <typename T>
+	inline static void fromInt24(const uint8_t* src, int stride, T* dst, int count)
+	{
+		constexpr T scale = T(1.0 / 8388608.0);
+
+		for (int i = 0; i < count; ++i)
+		{
+			const uint8_t* p = src + i * stride;
+			const int32_t v = int32_t(uint32_t(p[0]) << 8 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 24) >> 8;
+			dst[i] = T(v) * scale;
+		}
+	}
+
+	template <typename T>
+	inline static void fromInt32(const uint8_t* src, int stride, T* dst, int count)
+	{
+		constexpr T scale = T(1.0 / 2147483648.0);
+
+		for (int i = 0; i < count; ++i)
+		{
+			int32_t v;
+			memcpy(&v, src + i * stride, sizeof(v));
+			dst[i] = T(v) * scale;
+		}
+	}
+
+	template <typename T, typename F>
+	inline static void fromFloat(const uint8_t* src, int stride, T* dst, int count)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			F v;
+			memcpy(&v, src + i * stride, sizeof(v));
+			dst[i] = T(v);
+		}
+	}
+
+	template <typename T>
+	inline static void toInt16(const T* src, uint8_t* dst, int stride, int count)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			const int16_t v = int16_t(std::clamp(std::lrint(double(src[i]) * 32768.0), -32768L, 32767L));
+			memcpy(dst + i * stride, &v, sizeof(v));
+		}
+	}
+
+	template <typename T>
+	inline static void toInt24(const T* src, uint8_t* dst, int stride, int count)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			const int32_t v = int32_t(std::clamp(std::lrint(double(src[i]) * 8388608.0), -8388608L, 8388607L));
+			uint8_t* p = dst + i * stride;
+			p[0] = uint8_t(v);
+			p[1] = uint8_t(v >> 8);
+			p[2] = uint8_t(v >> 16);
+		}
+	}
+
+	template <typename T>
+	inline static void toFloat32(const T* src, uint8_t* dst, int stride, int count)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			const float v = float(src[i]);
+			memcpy(dst + i * stride, &v, sizeof(v));
+		}
+	}
+}
+
+//=========================================
+
+class WavReader {
+public:
+	bool open(const std::filesystem::path& path)
+	{
+		if (!file.open(path, MappedFile::Read) || file.size() < 12)
+			return false;
+
+		const uint8_t* header = file.map(0, 12);
+		const bool isRF64 = !memcmp(header, "RF64", 4);
+
+		if ((!isRF64 && memcmp(header, "RIFF", 4)) || memcmp(header + 8, "WAVE", 4))
+			return false;
+
+		uint64_t dataSize64 = 0;
+		bool hasFormat = false;
+		uint64_t offset = 12;
+
+		while (offset + 8 <= file.size())
+		{
+			const uint8_t* chunk = file.map(offset, 8);
+			const uint32_t chunkSize = read32(chunk + 4);
+			uint64_t size = chunkSize;
+
+			if (!memcmp(chunk, "ds64", 4))
+			{
+				const uint8_t* ds64 = file.map(offset + 8, 24);
+
+				if (!ds64)
+					return false;
+
+				dataSize64 = read64(ds64 + 8);
+			}
+			else if (!memcmp(chunk, "fmt ", 4))
+			{
+				const bool isExtensible = chunkSize >= 26;
+				const uint8_t* fmt = file.map(offset + 8, isExtensible ? 26 : 16);
+
+				if (!fmt || !parseFormat(fmt, isExtensible))
+					return false;
+
+				hasFormat = true;
+			}
+			else if (!memcmp(chunk, "data", 4))
+			{
+				if (isRF64 && chunkSize == 0xFFFFFFFF)
+					size = dataSize64;
+
+				dataOffset = offset + 8;
+				size = (std::min)(size, file.size() - dataOffset);
+				frames = hasFormat ? size / format.blockAlign() : 0;
+
+				return hasFormat;
+			}
+
+			offset += 8 + size + (size & 1);
+		}
+
+		return false;
+	}
+
+	// Reads count frames starting at frame into one buffer per channel.
+	template <typename T>
+	bool read(uint64_t frame, int count, T* const* channels)
+	{
+		const int stride = format.blockAlign();
+		const uint8_t* src = file.map(dataOffset + frame * stride, size_t(count) * stride);
+
+		if (!src)
+			return false;
+
+		for (int c = 0; c < format.channels; ++c)
+		{
+			const uint8_t* channel = src + c * format.bytesPerSample();
+
+			switch (format.encoding)
+			{
+			case WavFormat::Int16: WavConversion::fromInt16(channel, stride, channels[c], count); break;
+			case WavFormat::Int24: WavConversion::fromInt24(channel, stride, channels[c], count); break;
+			case WavFormat::Int32: WavConversion::fromInt32(channel, stride, channels[c], count); break;
+			case WavFormat::Float32: WavConversion::fromFloat<T, float>(channel, stride, channels[c], count); break;
+			case WavFormat::Float64: WavConversion::fromFloat<T, double>(channel, stride, channels[c], count); break;
+			default: return false;
+			}
+		}
+
+		return true;
+	}
+
+	WavFormat format;
+	uint64_t frames = 0;
+
+private:
+	bool parseFormat(const uint8_t* fmt, bool isExtensible)
+	{
+		uint16_t tag = read16(fmt);
+		const int bits = read16(fmt + 14);
+
+		// WAVE_FORMAT_EXTENSIBLE, the actual format is at the start of the sub format GUID.
+		if (tag == 0xFFFE && isExtensible)
+			tag = read16(fmt + 24);
+
+		format.channels = read16(fmt + 2);
+		format.sampleRate = read32(fmt + 4);
+
+		if (tag == 1)
+			format.encoding = bits == 16 ? WavFormat::Int16 : bits == 24 ? WavFormat::Int24 : bits == 32 ? WavFormat::Int32 : WavFormat::Unsupported;
+		else if (tag == 3)
+			format.encoding = bits == 32 ? WavFormat::Float32 : bits == 64 ? WavFormat::Float64 : WavFormat::Unsupported;
+		else
+			format.encoding = WavFormat::Unsupported;
+
+		return format.encoding != WavFormat::Unsupported && format.channels > 0;
+	}
+
+	static uint16_t read16(const uint8_t* p) { uint16_t v; memcpy(&v, p, 2); return v; }
+	static uint32_t read32(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+	static uint64_t read64(const uint8_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+
+	MappedFile file;
+	uint64_t dataOffset = 0;
+};
+
+//=========================================
+
+class WavWriter {
+public:
+	// Output is 16 or 24 bit PCM or 32 bit float. Switches to RF64 when the data doesn't fit a RIFF file.
+	bool open(const std::filesystem::path& path, const WavFormat& outputFormat, uint64_t numFrames)
+	{
+		format = outputFormat;
+		frames = numFrames;
+
+		if (format.encoding != WavFormat::Int16 && format.encoding != WavFormat::Int24 && format.encoding != WavFormat::Float32)
+			return false;
+
+		const uint64_t dataSize = frames * format.blockAlign();
+		const uint64_t fileSize = HEADER_SIZE + dataSize + (dataSize & 1);
+		const bool isRF64 = fileSize - 8 > 0xFFFFFFFF;
+
+		if (!file.open(path, MappedFile::Write, fileSize))
+			return false;
+
+		uint8_t* header = file.map(0, HEADER_SIZE);
+
+		if (!header)
+			return false;
+
+		memcpy(header, isRF64 ? "RF64" : "RIFF", 4);
+		write32(header + 4, isRF64 ? 0xFFFFFFFF : uint32_t(fileSize - 8));
+		memcpy(header + 8, "WAVE", 4);
+
+		// ds64 for RF64, otherwise a JUNK chunk of the same size so the layout doesn't change.
+		memcpy(header + 12, isRF64 ? "ds64" : "JUNK", 4);
+		write32(header + 16, 28);
+		memset(header + 20, 0, 28);
+
+		if (isRF64)
+		{
+			write64(header + 20, fileSize - 8);
+			write64(header + 28, dataSize);
+			write64(header + 36, frames);
+		}
+
+		memcpy(header + 48, "fmt ", 4);
+		write32(header + 52, 16);
+		write16(header + 56, format.encoding == WavFormat::Float32 ? 3 : 1);
+		write16(header + 58, uint16_t(format.channels));
+		write32(header + 60, uint32_t(format.sampleRate));
+		write32(header + 64, uint32_t(format.sampleRate * format.blockAlign()));
+		write16(header + 68, uint16_t(format.blockAlign()));
+		write16(header + 70, uint16_t(format.bytesPerSample() * 8));
+
+		memcpy(header + 72, "data", 4);
+		write32(header + 76, isRF64 ? 0xFFFFFFFF : uint32_t(dataSize));
+
+		return true;
+	}
+
+	// Writes into a file another writer opened with the same format and frames, so several threads
+	// can each write their own frames. The header is left as it is.
+	bool attach(const std::filesystem::path& path, const WavFormat& outputFormat, uint64_t numFrames)
+	{
+		format = outputFormat;
+		frames = numFrames;
+
+		return file.open(path, MappedFile::Update) && file.size() >= HEADER_SIZE + frames * format.blockAlign();
+	}
+
+	template <typename T>
+	bool write(uint64_t frame, int count, const T* const* channels)
+	{
+		const int stride = format.blockAlign();
+		uint8_t* dst = file.map(HEADER_SIZE + frame * stride, size_t(count) * stride);
+
+		if (!dst)
+			return false;
+
+		for (int c = 0; c < format.channels; ++c)
+		{
+			uint8_t* channel = dst + c * format.bytesPerSample();
+
+			switch (format.encoding)
+			{
+			case WavFormat::Int16: WavConversion::toInt16(channels[c], channel, stride, count); break;
+			case WavFormat::Int24: WavConversion::toInt24(channels[c], channel, stride, count); break;
+			case WavFormat::Float32: WavConversion::toFloat32(channels[c], channel, stride, count); break;
+			default: return false;
+			}
+		}
+
+		return true;
+	}
+
+	void close()
+	{
+		file.close();
+	}
+
+	WavFormat format;
+	uint64_t frames = 0;
+
+private:
+	static constexpr uint64_t HEADER_SIZE = 80;
+
+	static void write16(uint8_t* p, uint16_t v) { memcpy(p, &v, 2); }
+	static void write32(uint8_t* p, uint32_t v) { memcpy(p, &v, 4); }
+	static void write64(uint8_t* p, uint64_t v) { memcpy(p, &v, 8); }
+
+	MappedFile file;
+};